@@ -0,0 +1,217 @@
+// BulkFetch.cc for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+
+#include "BulkFetch.hh"
+
+#include "FbTk/App.hh"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#ifdef HAVE_XCB
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#endif // HAVE_XCB
+
+#include <cstdlib>
+
+namespace {
+
+#ifdef HAVE_XCB
+xcb_connection_t *connection() {
+    return XGetXCBConnection(FbTk::App::instance()->display());
+}
+#endif // HAVE_XCB
+
+} // end anonymous namespace
+
+namespace FbPager {
+
+BulkFetch::BulkFetch() {
+
+}
+
+BulkFetch::~BulkFetch() {
+#ifdef HAVE_XCB
+    for (size_t i = 0; i < m_requests.size(); ++i) {
+        if (!m_requests[i].read)
+            xcb_discard_reply(connection(), m_requests[i].sequence);
+    }
+#endif // HAVE_XCB
+}
+
+BulkFetch::Request BulkFetch::getProperty(Window win, Atom atom, Atom type,
+                                          unsigned long length) {
+    Pending pending;
+    pending.kind = Pending::PROPERTY;
+    pending.window = win;
+    pending.atom = atom;
+    pending.type = type;
+    pending.length = length;
+#ifdef HAVE_XCB
+    pending.sequence = xcb_get_property(connection(), 0, win, atom, type,
+                                        0, length).sequence;
+#endif // HAVE_XCB
+    return queue(pending);
+}
+
+BulkFetch::Request BulkFetch::getGeometry(Window win) {
+    Pending pending;
+    pending.kind = Pending::GEOMETRY;
+    pending.window = win;
+#ifdef HAVE_XCB
+    pending.sequence = xcb_get_geometry(connection(), win).sequence;
+#endif // HAVE_XCB
+    return queue(pending);
+}
+
+BulkFetch::Request BulkFetch::translateCoordinates(Window win, Window dest) {
+    Pending pending;
+    pending.kind = Pending::TRANSLATE;
+    pending.window = win;
+    pending.dest = dest;
+#ifdef HAVE_XCB
+    pending.sequence = xcb_translate_coordinates(connection(), win, dest,
+                                                 0, 0).sequence;
+#endif // HAVE_XCB
+    return queue(pending);
+}
+
+BulkFetch::Request BulkFetch::queue(const Pending &pending) {
+    m_requests.push_back(pending);
+    return m_requests.size() - 1;
+}
+
+BulkFetch::Pending *BulkFetch::take(Request req, Pending::Kind kind) {
+    if (req >= m_requests.size() || m_requests[req].read ||
+        m_requests[req].kind != kind)
+        return 0;
+
+    m_requests[req].read = true;
+    return &m_requests[req];
+}
+
+bool BulkFetch::property(Request req, std::vector<long> &data) {
+    Pending *pending = take(req, Pending::PROPERTY);
+    if (pending == 0)
+        return false;
+
+    data.clear();
+#ifdef HAVE_XCB
+    xcb_get_property_cookie_t cookie = { pending->sequence };
+    xcb_generic_error_t *error = 0;
+    xcb_get_property_reply_t *reply = xcb_get_property_reply(connection(),
+                                                             cookie, &error);
+    if (error != 0)
+        free(error);
+    if (reply == 0)
+        return false;
+
+    if (reply->format == 32) {
+        const uint32_t *values =
+            static_cast<const uint32_t *>(xcb_get_property_value(reply));
+        data.assign(values, values + xcb_get_property_value_length(reply) / 4);
+    }
+    free(reply);
+#else // !HAVE_XCB
+    Atom ret_type;
+    int fmt;
+    unsigned long nitems, bytes_after;
+    unsigned char *values = 0;
+    if (XGetWindowProperty(FbTk::App::instance()->display(), pending->window,
+                           pending->atom, 0, pending->length, False, pending->type,
+                           &ret_type, &fmt, &nitems, &bytes_after,
+                           &values) != Success)
+        return false;
+
+    if (values != 0) {
+        // Xlib hands out 32 bit items as longs
+        if (fmt == 32)
+            data.assign(reinterpret_cast<long *>(values),
+                        reinterpret_cast<long *>(values) + nitems);
+        XFree(values);
+    }
+#endif // HAVE_XCB
+
+    return !data.empty();
+}
+
+bool BulkFetch::geometry(Request req, int &x, int &y,
+                         unsigned int &width, unsigned int &height) {
+    Pending *pending = take(req, Pending::GEOMETRY);
+    if (pending == 0)
+        return false;
+
+#ifdef HAVE_XCB
+    xcb_get_geometry_cookie_t cookie = { pending->sequence };
+    xcb_generic_error_t *error = 0;
+    xcb_get_geometry_reply_t *reply = xcb_get_geometry_reply(connection(),
+                                                             cookie, &error);
+    if (error != 0)
+        free(error);
+    if (reply == 0)
+        return false;
+
+    x = reply->x;
+    y = reply->y;
+    width = reply->width;
+    height = reply->height;
+    free(reply);
+    return true;
+#else // !HAVE_XCB
+    Window root;
+    unsigned int border_width, depth;
+    return XGetGeometry(FbTk::App::instance()->display(), pending->window,
+                        &root, &x, &y, &width, &height,
+                        &border_width, &depth) != 0;
+#endif // HAVE_XCB
+}
+
+bool BulkFetch::coordinates(Request req, int &x, int &y) {
+    Pending *pending = take(req, Pending::TRANSLATE);
+    if (pending == 0)
+        return false;
+
+#ifdef HAVE_XCB
+    xcb_translate_coordinates_cookie_t cookie = { pending->sequence };
+    xcb_generic_error_t *error = 0;
+    xcb_translate_coordinates_reply_t *reply =
+        xcb_translate_coordinates_reply(connection(), cookie, &error);
+    if (error != 0)
+        free(error);
+    if (reply == 0)
+        return false;
+
+    x = reply->dst_x;
+    y = reply->dst_y;
+    free(reply);
+    return true;
+#else // !HAVE_XCB
+    Window child;
+    return XTranslateCoordinates(FbTk::App::instance()->display(),
+                                 pending->window, pending->dest,
+                                 0, 0, &x, &y, &child) != 0;
+#endif // HAVE_XCB
+}
+
+} // end namespace FbPager
@@ -0,0 +1,95 @@
+// BulkFetch.hh for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+
+#ifndef FBPAGER_BULKFETCH_HH
+#define FBPAGER_BULKFETCH_HH
+
+#include "FbTk/NotCopyable.hh"
+
+#include <X11/Xlib.h>
+
+#include <vector>
+
+namespace FbPager {
+
+/**
+   Asks the server about many windows with one round trip.
+   All requests are queued first and the replies are read afterwards:
+   \code
+   BulkFetch fetch;
+   for (size_t i = 0; i < windows.size(); ++i)
+       requests.push_back(fetch.getGeometry(windows[i]));
+   for (size_t i = 0; i < windows.size(); ++i)
+       fetch.geometry(requests[i], x, y, width, height);
+   \endcode
+   With XCB the requests are sent right away and each reply is
+   waited for when it's read. Without XCB each request is done
+   with a blocking Xlib call when it's read.
+   Each reply can be read once.
+*/
+class BulkFetch: private FbTk::NotCopyable {
+public:
+    typedef size_t Request;
+
+    BulkFetch();
+    /// discards the replies that weren't read
+    ~BulkFetch();
+
+    /// ask for up to length 32 bit items of property atom of win
+    Request getProperty(Window win, Atom atom, Atom type, unsigned long length);
+    /// ask for position relative to parent and size of win
+    Request getGeometry(Window win);
+    /// ask for the position of win's origin in dest
+    Request translateCoordinates(Window win, Window dest);
+
+    /// @return false if the window or the property doesn't exist
+    bool property(Request req, std::vector<long> &data);
+    /// @return false if the window doesn't exist
+    bool geometry(Request req, int &x, int &y,
+                  unsigned int &width, unsigned int &height);
+    /// @return false if the window doesn't exist
+    bool coordinates(Request req, int &x, int &y);
+
+private:
+    struct Pending {
+        enum Kind { PROPERTY, GEOMETRY, TRANSLATE };
+        Pending():kind(PROPERTY), window(0), dest(0), atom(0), type(0),
+                  length(0), sequence(0), read(false) { }
+        Kind kind;
+        Window window;
+        Window dest;
+        Atom atom, type;
+        unsigned long length;
+        unsigned int sequence; ///< XCB cookie
+        bool read;
+    };
+
+    Request queue(const Pending &pending);
+    /// @return pending request of kind, 0 if it's unknown or read
+    Pending *take(Request req, Pending::Kind kind);
+
+    std::vector<Pending> m_requests;
+};
+
+} // end namespace FbPager
+
+#endif // FBPAGER_BULKFETCH_HH
@@ -0,0 +1,271 @@
+// DiskCache.cc for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include "DiskCache.hh"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+namespace {
+
+/// written in native byte order, so other byte orders don't match
+const unsigned int MAGIC = 0x46425049; // "FBPI"
+const unsigned int VERSION = 1;
+
+struct Header {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int width, height;
+};
+
+const char SUFFIX[] = ".argb";
+
+size_t fileSize(unsigned int width, unsigned int height) {
+    return sizeof(Header) + static_cast<size_t>(width) * height * 4;
+}
+
+bool makeDirectory(const std::string &path) {
+    return mkdir(path.c_str(), 0700) == 0 || errno == EEXIST;
+}
+
+/// @return $XDG_CACHE_HOME/fbpager, created if needed, empty on failure
+std::string cacheDirectory() {
+    std::string base;
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    if (xdg != 0 && *xdg == '/')
+        base = xdg;
+    else {
+        const char *home = getenv("HOME");
+        if (home == 0 || *home == 0)
+            return "";
+        base = std::string(home) + "/.cache";
+    }
+
+    std::string directory = base + "/fbpager";
+    if (!makeDirectory(base) || !makeDirectory(directory))
+        return "";
+    return directory;
+}
+
+struct CacheFile {
+    CacheFile(time_t t, size_t s, const std::string &n):time(t), size(s), name(n) { }
+    bool operator < (const CacheFile &other) const { return time < other.time; }
+    time_t time;
+    size_t size;
+    std::string name;
+};
+
+/// @return all cache files in directory and their total size
+size_t listFiles(const std::string &directory, std::vector<CacheFile> &files) {
+    size_t total = 0;
+    DIR *dir = opendir(directory.c_str());
+    if (dir == 0)
+        return 0;
+
+    const size_t suffix_length = sizeof(SUFFIX) - 1;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != 0) {
+        std::string name = entry->d_name;
+        // skip temporary files, they are renamed or removed by their writer
+        if (name.size() <= suffix_length ||
+            name.compare(name.size() - suffix_length, suffix_length, SUFFIX) != 0)
+            continue;
+
+        std::string path = directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            continue;
+        files.push_back(CacheFile(info.st_mtime, info.st_size, path));
+        total += info.st_size;
+    }
+    closedir(dir);
+    return total;
+}
+
+} // end anonymous namespace
+
+namespace FbPager {
+
+DiskCache::Mapping::Mapping():m_address(0), m_length(0) { }
+
+DiskCache::Mapping::~Mapping() {
+    unmap();
+}
+
+const unsigned int *DiskCache::Mapping::pixels() const {
+    if (m_address == 0)
+        return 0;
+    return reinterpret_cast<const unsigned int *>(
+        static_cast<const char *>(m_address) + sizeof(Header));
+}
+
+void DiskCache::Mapping::unmap() {
+    if (m_address != 0)
+        munmap(m_address, m_length);
+    m_address = 0;
+    m_length = 0;
+}
+
+DiskCache::DiskCache(size_t budget):
+    m_budget(0),
+    m_used(0),
+    m_scanned(false) {
+    setBudget(budget);
+}
+
+void DiskCache::setBudget(size_t budget) {
+    m_budget = budget;
+    if (m_budget == 0)
+        return;
+
+    if (m_directory.empty())
+        m_directory = cacheDirectory();
+    if (m_scanned && m_used > m_budget)
+        evict();
+}
+
+bool DiskCache::find(unsigned long long hash, unsigned int width, unsigned int height,
+                     Mapping &mapping) {
+    mapping.unmap();
+    if (!enabled() || width == 0 || height == 0)
+        return false;
+
+    std::string path = filename(hash, width, height);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    const size_t length = fileSize(width, height);
+    struct stat info;
+    void *address = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) == length)
+        address = mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+        return false;
+
+    const Header *header = static_cast<const Header *>(address);
+    if (header->magic != MAGIC || header->version != VERSION ||
+        header->width != width || header->height != height) {
+        munmap(address, length);
+        return false;
+    }
+
+    mapping.m_address = address;
+    mapping.m_length = length;
+    // keep it from being evicted
+    utime(path.c_str(), 0);
+    return true;
+}
+
+void DiskCache::store(unsigned long long hash, unsigned int width, unsigned int height,
+                      const unsigned int *pixels) {
+    if (!enabled() || width == 0 || height == 0 || pixels == 0)
+        return;
+
+    const size_t length = fileSize(width, height);
+    // bigger than the cache, not worth a file
+    if (length > m_budget / 4)
+        return;
+
+    std::string path = filename(hash, width, height);
+    char pid[32];
+    sprintf(pid, ".%ld", static_cast<long>(getpid()));
+    std::string temp_path = path + pid;
+
+    int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        return;
+
+    Header header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.width = width;
+    header.height = height;
+    const size_t pixel_bytes = length - sizeof(Header);
+    bool written =
+        write(fd, &header, sizeof(Header)) == static_cast<ssize_t>(sizeof(Header)) &&
+        write(fd, pixels, pixel_bytes) == static_cast<ssize_t>(pixel_bytes);
+    close(fd);
+
+    // readers either see the old file or the whole new one
+    if (!written || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return;
+    }
+
+    if (!m_scanned) {
+        std::vector<CacheFile> files;
+        m_used = listFiles(m_directory, files);
+        m_scanned = true;
+    } else
+        m_used += length;
+
+    if (m_used > m_budget)
+        evict();
+}
+
+unsigned long long DiskCache::hash(const void *data, size_t size,
+                                   unsigned long long value) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        value ^= bytes[i];
+        value *= 1099511628211ULL;
+    }
+    return value;
+}
+
+std::string DiskCache::filename(unsigned long long hash,
+                                unsigned int width, unsigned int height) const {
+    char name[64];
+    sprintf(name, "/%016llx-%ux%u", hash, width, height);
+    return m_directory + name + SUFFIX;
+}
+
+void DiskCache::evict() {
+    // other instances write here too, so look at what is really there
+    std::vector<CacheFile> files;
+    m_used = listFiles(m_directory, files);
+    if (m_used <= m_budget)
+        return;
+
+    sort(files.begin(), files.end());
+    const size_t target = m_budget / 4 * 3;
+    for (size_t i = 0; i < files.size() && m_used > target; ++i) {
+        // mapped files stay valid for their readers after unlink
+        if (unlink(files[i].name.c_str()) == 0)
+            m_used -= min(m_used, files[i].size);
+    }
+}
+
+} // end namespace FbPager
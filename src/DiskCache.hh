@@ -0,0 +1,91 @@
+// DiskCache.hh for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FBPAGER_DISKCACHE_HH
+#define FBPAGER_DISKCACHE_HH
+
+#include "FbTk/NotCopyable.hh"
+
+#include <string>
+#include <cstddef>
+
+namespace FbPager {
+
+/**
+   Scaled ARGB32 images on disk, shared by all fbpager instances.
+   Each image is one file in $XDG_CACHE_HOME/fbpager, named by the
+   hash of the source image and the scaled size. A file is a small
+   header followed by the premultiplied pixels in native byte order,
+   so readers map it and use the pixels where they are. Files are
+   written to a temporary name and renamed, readers never see half
+   an image. When the directory grows above the budget the least
+   recently used files are removed.
+*/
+class DiskCache: private FbTk::NotCopyable {
+public:
+    /// a mapped image, unmapped when destroyed
+    class Mapping: private FbTk::NotCopyable {
+    public:
+        Mapping();
+        ~Mapping();
+        /// @return pixels, 0 if nothing is mapped
+        const unsigned int *pixels() const;
+        void unmap();
+    private:
+        friend class DiskCache;
+        void *m_address;
+        size_t m_length;
+    };
+
+    /// @param budget maximum size of the directory in bytes, 0 disables the cache
+    explicit DiskCache(size_t budget);
+
+    void setBudget(size_t budget);
+    bool enabled() const { return m_budget != 0 && !m_directory.empty(); }
+    /**
+       Maps image for hash and size
+       @return true if it was found, the pixels are in mapping
+    */
+    bool find(unsigned long long hash, unsigned int width, unsigned int height,
+              Mapping &mapping);
+    /// stores width * height premultiplied ARGB32 pixels
+    void store(unsigned long long hash, unsigned int width, unsigned int height,
+               const unsigned int *pixels);
+
+    /// 64 bit FNV-1a hash of data, to continue a hash pass the previous value
+    static unsigned long long hash(const void *data, size_t size,
+                                   unsigned long long value = 14695981039346656037ULL);
+
+private:
+    std::string filename(unsigned long long hash,
+                         unsigned int width, unsigned int height) const;
+    /// removes the oldest files until the directory is below 3/4 of the budget
+    void evict();
+
+    std::string m_directory; ///< empty if it couldn't be created
+    size_t m_budget;
+    size_t m_used; ///< bytes in the directory, as far as we know
+    bool m_scanned; ///< wheter m_used was read from the directory
+};
+
+} // end namespace FbPager
+
+#endif // FBPAGER_DISKCACHE_HH
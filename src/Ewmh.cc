@@ -28,11 +28,13 @@
 #include "FbTk/FbWindow.hh"
 #include "FbRootWindow.hh"
 #include "PropertyTools.hh"
+#include "BulkFetch.hh"
 
 #include <X11/Xatom.h>
 
 #include <iostream>
 #include <vector>
+#include <map>
 #include <sys/types.h>
 #include <unistd.h>
 #include <memory>
@@ -99,6 +101,60 @@ public:
         close_window = XInternAtom(disp, "_NET_CLOSE_WINDOW", False);
         desktop_layout = XInternAtom(disp, "_NET_DESKTOP_LAYOUT", False);
     }
+
+    /// the properties getHints reads
+    struct HintProperties {
+        std::vector<long> states, types, desktop;
+    };
+
+    /// send the requests for the hint properties of win
+    void requestHints(BulkFetch &fetch, Window win,
+                      std::vector<BulkFetch::Request> &requests) const {
+        requests.push_back(fetch.getProperty(win, wm_state, XA_ATOM, 0x7FFFFFFF));
+        requests.push_back(fetch.getProperty(win, wm_type, XA_ATOM, 0x7FFFFFFF));
+        requests.push_back(fetch.getProperty(win, wm_desktop, XA_CARDINAL, 1));
+    }
+
+    /// read the replies of requestHints, starting at requests[first]
+    void readHints(BulkFetch &fetch, const std::vector<BulkFetch::Request> &requests,
+                   size_t first, HintProperties &props) const {
+        fetch.property(requests[first], props.states);
+        fetch.property(requests[first + 1], props.types);
+        fetch.property(requests[first + 2], props.desktop);
+    }
+
+    void addHints(const HintProperties &props, WindowHint &hint) const {
+        for (size_t i = 0; i < props.states.size(); ++i) {
+            Atom state = static_cast<Atom>(props.states[i]);
+            if (state == state_skip_pager)
+                hint.add(WindowHint::WHINT_SKIP_PAGER);
+            else if (state == state_skip_taskbar)
+                hint.add(WindowHint::WHINT_SKIP_TASKBAR);
+            else if (state == state_sticky)
+                hint.add(WindowHint::WHINT_STICKY);
+            else if (state == state_shaded)
+                hint.add(WindowHint::WHINT_SHADED);
+        }
+
+        // we only care about the first type.
+        if (!props.types.empty() && static_cast<Atom>(props.types[0]) == type_dock)
+            hint.add(WindowHint::WHINT_TYPE_DOCK);
+
+        if (!props.desktop.empty())
+            hint.setWorkspace(static_cast<int>(props.desktop[0]));
+    }
+
+    /// hint properties read with the client list, only valid while it's handled
+    typedef std::map<Window, HintProperties> HintMap;
+    HintMap prefetched;
+    /// empties prefetched when the client list is handled, even if it throws
+    class PrefetchGuard {
+    public:
+        explicit PrefetchGuard(HintMap &hints):m_hints(hints) { }
+        ~PrefetchGuard() { m_hints.clear(); }
+    private:
+        HintMap &m_hints;
+    };
     Atom state_skip_pager, state_skip_taskbar, state_sticky,
         state_hidden, state_shaded, state_above, state_below;
     Atom wm_desktop, wm_state, wm_pid, wm_type;
@@ -192,12 +248,39 @@ bool Ewmh::propertyNotify(Pager &pager, XPropertyEvent &event) try {
     } else if (event.atom == m_data->clientlist) {
         vector<Window> windows;
         getWinArrayProperty(DefaultRootWindow(FbTk::App::instance()->display()), event.atom, windows);
+
+        // ask for the workspace of all windows, and the hints of the
+        // new ones, before waiting for the first reply. getHints uses
+        // them while the pager adds the new windows
+        BulkFetch fetch;
+        vector<BulkFetch::Request> requests;
+        vector<size_t> first(windows.size());
+        vector<bool> known(windows.size());
+        for (size_t win = 0; win < windows.size(); ++win) {
+            first[win] = requests.size();
+            known[win] = pager.haveWindow(windows[win]);
+            if (known[win])
+                requests.push_back(fetch.getProperty(windows[win], m_data->wm_desktop,
+                                                     XA_CARDINAL, 1));
+            else
+                m_data->requestHints(fetch, windows[win], requests);
+        }
+
+        Ewmh_priv::PrefetchGuard guard(m_data->prefetched);
         std::vector< pair<Window, unsigned int > > wins_workspaces;
-        for ( unsigned int win = 0; win < windows.size(); ++win ) {
+        for (size_t win = 0; win < windows.size(); ++win) {
+            vector<long> desktop;
+            if (known[win])
+                fetch.property(requests[first[win]], desktop);
+            else {
+                Ewmh_priv::HintProperties &props = m_data->prefetched[windows[win]];
+                m_data->readHints(fetch, requests, first[win], props);
+                desktop = props.desktop;
+            }
             wins_workspaces.
                 push_back( std::make_pair(windows[win],
-                                          getIntProperty(windows[win],
-                                                         m_data->wm_desktop)));
+                                          desktop.empty() ? 0 :
+                                          static_cast<unsigned int>(desktop[0])));
         }
         pager.addWindows(wins_workspaces);
     } else {
@@ -309,40 +392,20 @@ void Ewmh::setHints(FbTk::FbWindow &win, WindowHint &hint) {
 
 
 void Ewmh::getHints(const FbTk::FbWindow &win, WindowHint &hint) const {
-    PropTPtr p(property(win,
-                        m_data->wm_state,
-                        XA_ATOM, 0x7FFFFFFF));
-
-    if (p.get() != 0 && p->data != 0) {
-
-        Atom *states = (Atom *)(p->data);
-        for (int i=0; i<p->num; ++i) {
-            if (states[i] == m_data->state_skip_pager)
-                hint.add(WindowHint::WHINT_SKIP_PAGER);
-            else if (states[i] == m_data->state_skip_taskbar)
-                hint.add(WindowHint::WHINT_SKIP_TASKBAR);
-            else if (states[i] == m_data->state_sticky)
-                hint.add(WindowHint::WHINT_STICKY);
-            else if (states[i] == m_data->state_shaded)
-                hint.add(WindowHint::WHINT_SHADED);
-        }
+    Ewmh_priv::HintMap::const_iterator it = m_data->prefetched.find(win.window());
+    if (it != m_data->prefetched.end()) {
+        m_data->addHints(it->second, hint);
+        return;
     }
 
-    p.reset(property(win, m_data->wm_type,
-                     XA_ATOM, 0x7FFFFFFF));
-    if (p.get() != 0 && p->data != 0) {
-        // we only care about the first type.
-        Atom *atoms = (Atom *)p->data;
-        if (atoms[0] == m_data->type_dock)
-            hint.add(WindowHint::WHINT_TYPE_DOCK);
-    }
-
-    p.reset(property(win, m_data->wm_desktop,
-                     XA_CARDINAL, 1));
-    if (p.get() != 0 && p->data != 0) {
-        int workspace = static_cast<int>(*(p->data));
-        hint.setWorkspace(workspace);
-    }
+    // with XCB all three requests share one round trip,
+    // without it they are three serial Xlib calls
+    BulkFetch fetch;
+    vector<BulkFetch::Request> requests;
+    m_data->requestHints(fetch, win.window(), requests);
+    Ewmh_priv::HintProperties props;
+    m_data->readHints(fetch, requests, 0, props);
+    m_data->addHints(props, hint);
 }
 
 int Ewmh::numberOfWorkspaces(int screen_num) const {
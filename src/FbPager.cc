@@ -28,6 +28,8 @@
 #include "FbTk/App.hh"
 #include "FbTk/Color.hh"
 #include "FbTk/StringUtil.hh"
+#include "FbTk/RedrawScheduler.hh"
+#include "FbTk/RootPixmap.hh"
 
 // client handlers
 #include "Ewmh.hh"
@@ -128,6 +130,10 @@ FbPager::FbPager(int screen_num, bool withdraw,
              ButtonPressMask | ButtonReleaseMask | ExposureMask |
              FocusChangeMask | StructureNotifyMask|
              SubstructureRedirectMask),
+    m_geometry(m_rootwin),
+    m_icons(0, 0),
+    m_thumbnails(*this, m_index, screen_num),
+    m_sticky(m_index, m_geometry),
     m_curr_workspace(0),
     m_move_window(),
     m_resmanager(0, false),
@@ -212,9 +218,36 @@ FbPager::FbPager(int screen_num, bool withdraw,
     m_multiclick_time(m_resmanager, 250,
                       "fbpager.multiClickTime",
                       "FbPager.MultiClickTime"),
+    m_max_fps(m_resmanager, 60,
+              "fbpager.maxFps",
+              "FbPager.MaxFps"),
     m_window_icons(m_resmanager, false,
                    "fbpager.icons",
                    "FbPager.Icons"),
+    m_workspace_buffer(m_resmanager, false,
+                       "fbpager.workspaceBuffer",
+                       "FbPager.WorkspaceBuffer"),
+    m_single_window(m_resmanager, false,
+                    "fbpager.singleWindow",
+                    "FbPager.SingleWindow"),
+    m_icon_cache_size(m_resmanager, 1024,
+                      "fbpager.iconCacheSize",
+                      "FbPager.IconCacheSize"),
+    m_icon_disk_cache_size(m_resmanager, 4096,
+                           "fbpager.iconDiskCacheSize",
+                           "FbPager.IconDiskCacheSize"),
+    m_window_thumbnails(m_resmanager, false,
+                        "fbpager.thumbnails",
+                        "FbPager.Thumbnails"),
+    m_thumbnail_interval(m_resmanager, 200,
+                         "fbpager.thumbnailInterval",
+                         "FbPager.ThumbnailInterval"),
+    m_workspace_snapshots(m_resmanager, false,
+                          "fbpager.snapshots",
+                          "FbPager.Snapshots"),
+    m_snapshot_interval(m_resmanager, 2000,
+                        "fbpager.snapshotInterval",
+                        "FbPager.SnapshotInterval"),
     m_window_border_width(m_resmanager, 1,
                           "fbpager.windowBorderWidth",
                           "FbPager.WindowBorderWidth"),
@@ -230,7 +263,12 @@ FbPager::FbPager(int screen_num, bool withdraw,
     m_workspace_border_inactive_color(m_resmanager, "white",
                                       "fbpager.border.inactive.color",
                                       "FbPager.Border.Inactive.Color"),
-    m_last_workspace_num(-1) {
+    m_last_workspace_num(-1),
+    m_motion_pending(false),
+    m_motion_cmd(*this, &FbPager::flushMotion),
+    m_motion_timer(m_motion_cmd),
+    m_snapshot_cmd(*this, &FbPager::takeSnapshot),
+    m_snapshot_timer(m_snapshot_cmd) {
 
     m_clienthandlers.push_back(new Ewmh());
 
@@ -281,6 +319,13 @@ FbPager::FbPager(int screen_num, bool withdraw,
     if (resource_filename != 0)
         load(resource_filename);
 
+    updateFrameRate();
+    m_icons.setBudget(std::max(*m_icon_cache_size, 0) * 1024);
+    m_icons.setDiskBudget(std::max(*m_icon_disk_cache_size, 0) * 1024);
+    m_thumbnails.setInterval(std::max(*m_thumbnail_interval, 0));
+    m_thumbnails.setEnabled(*m_window_thumbnails);
+    m_sticky.setBorderWidth(std::max(*m_window_border_width, 0));
+
 
     int real_layer_flag = layer_flag;
 
@@ -326,6 +371,8 @@ FbPager::FbPager(int screen_num, bool withdraw,
     }
 
     updateWorkspaceCount(workspaces);
+    m_snapshot_timer.fireOnce(false);
+    updateSnapshots();
     // finaly show window
     show();
     m_window.move(*m_start_x, *m_start_y);
@@ -363,10 +410,14 @@ void FbPager::hide() {
 
 void FbPager::handleEvent(XEvent &event) {
     // here we handle events that're not in FbTk::EventHandler interface
+    if (m_thumbnails.handleEvent(event))
+        return;
+
     if (event.type == ClientMessage)
         clientMessageEvent(event.xclient);
     else if (event.type == ConfigureNotify) {
         if (event.xconfigure.window != m_window.window()) {
+            m_geometry.configureNotify(event.xconfigure);
             updateWindowHints(event.xconfigure.window);
         } else if (event.xconfigure.send_event == True){
             if (event.xconfigure.x != m_window.x() ||
@@ -385,6 +436,14 @@ void FbPager::handleEvent(XEvent &event) {
         }
     } else if (event.type == PropertyNotify) {
         propertyEvent(event.xproperty);
+    } else if (event.type == ReparentNotify) {
+        // root position is kept relative to the parent, so start over
+        m_geometry.remove(event.xreparent.window);
+        updateWindowHints(event.xreparent.window);
+    } else if (event.type == DestroyNotify) {
+        m_geometry.remove(event.xdestroywindow.window);
+        m_icons.remove(event.xdestroywindow.window);
+        m_thumbnails.remove(event.xdestroywindow.window);
     } else {
 
     }
@@ -417,25 +476,37 @@ void FbPager::buttonPressEvent(XButtonEvent &event) {
         m_move_window.curr_window = 0;
         m_move_window.client = ClientWindow(0);
 
+        Workspace *workspace = 0;
+        Window client = 0;
         FbTk::FbWindow *win = 0;
-        for (size_t w = 0; w < m_workspaces.size(); ++w) {
-            win = m_workspaces[w]->find(event.subwindow);
-            if (win && win->parent() != 0) {
-                m_move_window.client = m_workspaces[w]->findClient(*win);
-                m_move_window.curr_window = win;
-                m_move_window.curr_workspace= m_workspaces[w];
-                m_grab_x = event.x - win->x();
-                m_grab_y = event.y - win->y();
-
-                // drag -> move it above all workspaces
-                if (event.button == *m_drag_to_workspace_button) {
-                    m_move_window.curr_window->reparent(m_window,
-                                                        m_move_window.curr_window->x() +
-                                                        m_move_window.curr_workspace->window().x(),
-                                                        m_move_window.curr_window->y() +
-                                                        m_move_window.curr_workspace->window().y());
-                }
-                break;
+        const WindowIndex::Entry *entry = m_index.find(event.subwindow);
+        if (entry != 0 && entry->client != 0) {
+            workspace = entry->workspace;
+            client = entry->client;
+            win = entry->window;
+        } else if (*m_single_window && (entry = m_index.find(event.window)) != 0) {
+            // mini windows are only drawn, find the one below the
+            // pointer and get a window to drag
+            workspace = entry->workspace;
+            client = workspace->clientAt(event.x, event.y);
+            if (client != 0)
+                win = workspace->grab(client);
+        }
+
+        if (win != 0) {
+            m_move_window.client = ClientWindow(client);
+            m_move_window.curr_window = win;
+            m_move_window.curr_workspace = workspace;
+            m_grab_x = event.x - win->x();
+            m_grab_y = event.y - win->y();
+
+            // drag -> move it above all workspaces
+            if (event.button == *m_drag_to_workspace_button) {
+                m_move_window.curr_window->reparent(m_window,
+                                                    m_move_window.curr_window->x() +
+                                                    m_move_window.curr_workspace->window().x(),
+                                                    m_move_window.curr_window->y() +
+                                                    m_move_window.curr_workspace->window().y());
             }
         }
     }
@@ -443,6 +514,9 @@ void FbPager::buttonPressEvent(XButtonEvent &event) {
 }
 
 void FbPager::buttonReleaseEvent(XButtonEvent &event) {
+    // make sure we drop the window where the pointer is
+    flushMotion();
+    m_motion_timer.stop();
 
     ClientWindow client(0);
     if (m_move_window.curr_window != 0 &&
@@ -457,6 +531,7 @@ void FbPager::buttonReleaseEvent(XButtonEvent &event) {
         m_move_window.client.move(client_x, client_y);
         client = m_move_window.client;
         m_move_window.client = ClientWindow(0);
+        m_move_window.curr_workspace->ungrab();
         m_move_window.curr_window = 0;
 
     }
@@ -495,6 +570,12 @@ void FbPager::buttonReleaseEvent(XButtonEvent &event) {
 
         // move it to the right position
         FbTk::FbWindow &win = *m_move_window.curr_window;
+        // reparenting put it on top, keep the drawing order in sync
+        Workspace &curr_workspace = *m_move_window.curr_workspace;
+        if (win.parent() == &curr_workspace.window() &&
+            curr_workspace.find(m_move_window.client.window()) == &win)
+            curr_workspace.raiseWindow(m_move_window.client.window());
+
         int client_x = win.x(), client_y = win.y();
         scaleFromWindowToWindow(*(win.parent()),
                                 m_rootwin,
@@ -504,6 +585,7 @@ void FbPager::buttonReleaseEvent(XButtonEvent &event) {
 
         // clean up
         m_move_window.client = ClientWindow(0);
+        m_move_window.curr_workspace->ungrab();
         m_move_window.curr_window = 0;
         m_move_window.curr_workspace = 0;
         m_button_queue.erase();
@@ -512,24 +594,9 @@ void FbPager::buttonReleaseEvent(XButtonEvent &event) {
         // change workspace
 
         // find out which workspace
-        Workspace *workspace = 0;
-        FbTk::FbWindow *win = 0;
-        size_t workspace_it = 0;
-        for (; workspace_it < m_workspaces.size(); ++workspace_it) {
-            if (m_workspaces[workspace_it]->window() == event.window) {
-                workspace = m_workspaces[workspace_it];
-                break;
-            } else {
-                win = m_workspaces[workspace_it]->find(event.window);
-                if (win != 0) {
-                    workspace = m_workspaces[workspace_it];
-                    break;
-                }
-            }
-        }
-
-        if (workspace != 0)
-            sendChangeToWorkspace(workspace_it);
+        const WindowIndex::Entry *entry = m_index.find(event.window);
+        if (entry != 0)
+            sendChangeToWorkspace(entry->workspace->number());
 
     } else if (compareButtonQueues(m_button_queue, *m_raise_window_button) &&
                client.window() != 0) {
@@ -569,6 +636,32 @@ void FbPager::buttonReleaseEvent(XButtonEvent &event) {
 }
 
 void FbPager::motionNotifyEvent(XMotionEvent &event) {
+    if (m_move_window.curr_window == 0 ||
+        m_move_window.curr_workspace == 0)
+        return;
+
+    // only the newest position matters, the rest of
+    // this frame's motion events just replace it
+    m_motion = event;
+    if (m_motion_timer.isTiming()) {
+        m_motion_pending = true;
+        return;
+    }
+
+    dragWindow(m_motion);
+    m_motion_timer.start();
+}
+
+void FbPager::flushMotion() {
+    if (!m_motion_pending)
+        return;
+
+    m_motion_pending = false;
+    dragWindow(m_motion);
+    m_motion_timer.start();
+}
+
+void FbPager::dragWindow(XMotionEvent &event) {
 
     if (m_move_window.curr_window != 0 &&
         m_move_window.curr_workspace != 0) {
@@ -635,26 +728,25 @@ void FbPager::motionNotifyEvent(XMotionEvent &event) {
 }
 
 void FbPager::exposeEvent(XExposeEvent &event) {
-    if (m_window == event.window) {
-        m_window.clearArea(event.x, event.y,
-                           event.width, event.height);
-    } else {
-        for (size_t w = 0; w < m_workspaces.size(); ++w) {
-            if (m_workspaces[w]->window() == event.window) {
-                FbTk::FbWindow &win = m_workspaces[w]->window();
-                win.clearArea(event.x, event.y,
-                              event.width, event.height);
-                return;
-            } else {
-                FbTk::FbWindow *win = m_workspaces[w]->find(event.window);
-                if (win != 0) {
-                    win->clearArea(event.x, event.y,
-                                   event.width, event.height);
-                    return;
-                }
-            }
-        }
+    FbTk::FbWindow *win = 0;
+    if (m_window == event.window)
+        win = &m_window;
+    else {
+        const WindowIndex::Entry *entry = m_index.find(event.window);
+        if (entry != 0)
+            win = entry->window;
     }
+
+    if (win == 0)
+        return;
+
+    // collect the exposed areas and repaint them together
+    // when the last expose event in this series arrives
+    FbTk::RedrawScheduler &redraw = *FbTk::RedrawScheduler::instance();
+    redraw.markDirty(*win, event.x, event.y,
+                     event.width, event.height);
+    if (event.count == 0)
+        redraw.flush(*win);
 }
 
 void FbPager::clientMessageEvent(XClientMessageEvent &event) {
@@ -672,6 +764,15 @@ void FbPager::clientMessageEvent(XClientMessageEvent &event) {
 }
 
 void FbPager::propertyEvent(XPropertyEvent &event) {
+    if (FbTk::RootPixmap::instance()->propertyNotify(event)) {
+        // new wallpaper, repaint everything that's transparent
+        clearWindows();
+        return;
+    }
+
+    m_geometry.propertyNotify(event);
+    m_icons.propertyNotify(event);
+
     ClientHandlerList::iterator it = m_clienthandlers.begin();
     ClientHandlerList::iterator it_end = m_clienthandlers.end();
     for (; it != it_end; ++it) {
@@ -680,23 +781,63 @@ void FbPager::propertyEvent(XPropertyEvent &event) {
     updateWindowHints(event.window);
 }
 
-void FbPager::eraseAllWindows() {
-    for_each(m_workspaces.begin(), m_workspaces.end(),
-             mem_fun(&Workspace::removeAll));
-    WindowList::iterator it = m_windows.begin();
-    for (; it != m_windows.end(); ++it) {
-        FbTk::EventManager::instance()->remove(*it);
+void FbPager::addWindows(const WindowsAndWorkspaces& wins) {
+    // diff the sorted client list against the windows we have,
+    // only windows that came, went or changed workspace are touched
+    WindowsAndWorkspaces sorted(wins);
+    sort(sorted.begin(), sorted.end());
+
+    vector<Window> removed;
+    WindowsAndWorkspaces added, moved;
+    WindowList::const_iterator it = m_windows.begin();
+    WindowList::const_iterator it_end = m_windows.end();
+    for (size_t i = 0; i < sorted.size() || it != it_end; ) {
+        if (i > 0 && i < sorted.size() && sorted[i].first == sorted[i - 1].first) {
+            ++i; // listed twice
+        } else if (i == sorted.size() || (it != it_end && *it < sorted[i].first)) {
+            removed.push_back(*it);
+            ++it;
+        } else if (it == it_end || sorted[i].first < *it) {
+            added.push_back(sorted[i]);
+            ++i;
+        } else {
+            if (movedWorkspace(sorted[i].first, sorted[i].second))
+                moved.push_back(sorted[i]);
+            ++i;
+            ++it;
+        }
     }
-    m_windows.clear();
+
+    for_each(removed.begin(), removed.end(),
+             bind1st(mem_fun(&FbPager::removeWindow), this));
+    for (size_t i = 0; i < moved.size(); ++i)
+        moveToWorkspace(moved[i].first, moved[i].second);
+
+    // one round trip for the geometry of all new windows
+    vector<Window> added_windows;
+    for (size_t i = 0; i < added.size(); ++i)
+        added_windows.push_back(added[i].first);
+    m_geometry.prefetch(added_windows);
+
+    for (size_t i = 0; i < added.size(); ++i)
+        addWindow(added[i].first, added[i].second);
 }
 
-void FbPager::addWindows(const WindowsAndWorkspaces& wins) {
-    // destroy all old windows
-    eraseAllWindows();
+bool FbPager::movedWorkspace(Window win, unsigned int workspace_num) const {
+    // sticky windows and windows the pager doesn't show are
+    // updated through their hints
+    if (workspace_num >= m_workspaces.size())
+        return false;
 
-    for (unsigned int w = 0; w < wins.size(); ++w) {
-        addWindow(wins[w].first, wins[w].second);
+    const WindowIndex::Entries *entries = m_index.findClient(win);
+    if (entries == 0)
+        return false;
+
+    for (size_t i = 0; i < entries->size(); ++i) {
+        if ((*entries)[i].workspace->number() == workspace_num)
+            return false;
     }
+    return true;
 }
 
 void FbPager::addWindow(Window win, unsigned int workspace_num) {
@@ -713,15 +854,20 @@ void FbPager::addWindow(Window win, unsigned int workspace_num) {
 
 void FbPager::moveToWorkspace(Window win, unsigned int w) {
     if (w >= 0x7FFFFFFF) {
-        updateWindowHints(w);
+        updateWindowHints(win);
         return;
     } else if (w >= m_workspaces.size())
         return;
 
     // remove from old workspace
-    for (size_t workspace=0; workspace < m_workspaces.size(); ++workspace) {
-        if (w != workspace && m_workspaces[workspace]->find(win) != 0)
-            m_workspaces[workspace]->remove(win);
+    const WindowIndex::Entries *entries = m_index.findClient(win);
+    if (entries != 0) {
+        // removing changes the index, so work on a copy
+        WindowIndex::Entries old_entries(*entries);
+        for (size_t i = 0; i < old_entries.size(); ++i) {
+            if (old_entries[i].workspace->number() != w)
+                old_entries[i].workspace->remove(win);
+        }
     }
 
     addWindow(win, w);
@@ -738,8 +884,12 @@ void FbPager::removeWindow(Window win) {
     for_each(m_workspaces.begin(),
              m_workspaces.end(),
              bind2nd(mem_fun(&Workspace::remove), win));
+    m_sticky.remove(win);
     FbTk::EventManager::instance()->remove(win);
     m_windows.erase(win);
+    m_geometry.remove(win);
+    m_icons.remove(win);
+    m_thumbnails.remove(win);
 }
 
 void FbPager::updateWorkspaceCount(unsigned int num) {
@@ -763,7 +913,12 @@ void FbPager::updateWorkspaceCount(unsigned int num) {
         FbTk::Color backgroundcol(m_background_color_str->c_str(), m_window.screenNumber());
 
         while (m_workspaces.size() != num) {
-            Workspace *w = new Workspace(*this, m_window,
+            Workspace *w = new Workspace(*this,
+                                         m_index, m_geometry,
+                                         m_icons, m_thumbnails,
+                                         m_sticky,
+                                         m_workspaces.size(),
+                                         m_window,
                                          width, height,
                                          focusedcolor,
                                          wincolor,
@@ -772,6 +927,8 @@ void FbPager::updateWorkspaceCount(unsigned int num) {
                                          "workspace",
                                          *m_window_icons,
                                          *m_window_border_width);
+            w->setSingleWindow(*m_single_window);
+            w->setUseBuffer(*m_workspace_buffer || *m_single_window);
             w->setAlpha(*m_alpha);
             w->window().setBorderWidth(*m_workspace_border_width);
             m_workspaces.push_back(w);
@@ -792,20 +949,21 @@ void FbPager::updateWorkspaceCount(unsigned int num) {
     m_window.showSubwindows();
 }
 
-void setupWindow( FbTk::FbWindow &window,
+void setupWindow( Workspace &workspace,
                   const std::string &bg_color,
                   const std::string &border_color,
                   unsigned int border_width ) {
 
-    window.setBackgroundColor(FbTk::Color(bg_color.c_str(),
-                                          window.screenNumber()));
+    FbTk::FbWindow &window = workspace.window();
+    workspace.setBackgroundColor(FbTk::Color(bg_color.c_str(),
+                                             window.screenNumber()));
 
     window.setBorderColor(FbTk::
                           Color(border_color.c_str(),
                                 window.screenNumber()));
 
     window.setBorderWidth(border_width);
-    window.clear();
+    FbTk::RedrawScheduler::instance()->markDirty(window);
 
 }
 
@@ -815,7 +973,7 @@ void FbPager::setCurrentWorkspace(unsigned int num) {
 
     // set current workspaces background to "normal" background,
     FbTk::FbWindow &oldWindow = m_workspaces[m_curr_workspace]->window();
-    setupWindow(oldWindow,
+    setupWindow(*m_workspaces[m_curr_workspace],
                 *m_background_color_str,
                 *m_workspace_border_inactive_color,
                 *m_workspace_border_inactive_width);
@@ -823,7 +981,7 @@ void FbPager::setCurrentWorkspace(unsigned int num) {
     // set next workspace background
     // update workspace background
     FbTk::FbWindow& newWindow = m_workspaces[num]->window();
-    setupWindow(newWindow,
+    setupWindow(*m_workspaces[num],
                 *m_current_background_color_str,
                 *m_workspace_border_active_color,
                 *m_workspace_border_width);
@@ -835,6 +993,13 @@ void FbPager::setCurrentWorkspace(unsigned int num) {
                         oldWindow.y() );
     }
 
+    if (*m_workspace_snapshots) {
+        m_workspaces[m_curr_workspace]->showSnapshot(true);
+        m_workspaces[num]->showSnapshot(false);
+        // give the windows on the new workspace time to draw
+        m_snapshot_timer.start();
+    }
+
     m_curr_workspace = num;
 }
 
@@ -887,6 +1052,7 @@ void FbPager::alignWorkspaces() {
         (*it)->window().move(next_pos_x, next_pos_y);
         (*it)->resize(workspace_width, workspace_height);
     }
+    m_sticky.resize();
 
     m_window.resize(max_x + 2*bevel, max_y + 2*bevel);
 
@@ -907,6 +1073,10 @@ void FbPager::alignWorkspaces() {
 void FbPager::sendChangeToWorkspace(unsigned int num) {
     assert(num < m_workspaces.size());
 
+    // last chance to grab the workspace we leave
+    if (*m_workspace_snapshots && num != m_curr_workspace)
+        takeSnapshot();
+
     ClientHandlerList::iterator it = m_clienthandlers.begin();
     ClientHandlerList::iterator it_end = m_clienthandlers.end();
     for (; it != it_end; ++it)
@@ -915,6 +1085,10 @@ void FbPager::sendChangeToWorkspace(unsigned int num) {
 }
 
 void FbPager::updateWindowHints(Window win) {
+    // only clients from the client list are shown
+    if (!haveWindow(win))
+        return;
+
     WindowHint hint;
     ClientWindow client(win);
     ClientHandlerList::iterator it = m_clienthandlers.begin();
@@ -922,8 +1096,31 @@ void FbPager::updateWindowHints(Window win) {
     for (; it != it_end; ++it)
         (*it)->getHints(client, hint);
 
+    if (*m_single_window) {
+        if ((hint.flags() & WindowHint::WHINT_STICKY) &&
+            !(hint.flags() & WindowHint::WHINT_SKIP_PAGER) &&
+            !(hint.flags() & WindowHint::WHINT_TYPE_DOCK)) {
+            // kept once in the sticky layer instead of on every workspace
+            for_each(m_workspaces.begin(),
+                     m_workspaces.end(),
+                     bind2nd(mem_fun(&Workspace::remove), win));
+            m_sticky.add(win);
+            m_sticky.updateGeometry(win);
+            if (hint.flags() & WindowHint::WHINT_SHADED)
+                m_sticky.shade(win);
+            else
+                m_sticky.setIconic(win, hint.flags() & WindowHint::WHINT_ICONIC);
+            return;
+        }
+
+        // no longer sticky, back to its own workspace
+        if (m_sticky.remove(win) && hint.workspace() >= 0 &&
+            static_cast<size_t>(hint.workspace()) < m_workspaces.size())
+            m_workspaces[hint.workspace()]->add(win);
+    }
+
     for (int workspace = 0; workspace < m_workspaces.size(); workspace++) {
-        if (m_workspaces[workspace]->find(win) == 0) {
+        if (!m_workspaces[workspace]->has(win)) {
             // if the window is sticky then add it to this workspace too
             // and if it's not skip_pager nor type_dock
             if ((hint.flags() & WindowHint::WHINT_STICKY) &&
@@ -964,6 +1161,7 @@ void FbPager::raiseWindow(Window win) {
     for_each(m_workspaces.begin(),
              m_workspaces.end(),
              bind2nd(mem_fun(&Workspace::raiseWindow), win));
+    m_sticky.raise(win);
 }
 
 void FbPager::lowerWindow(Window win) {
@@ -971,6 +1169,7 @@ void FbPager::lowerWindow(Window win) {
     for_each(m_workspaces.begin(),
              m_workspaces.end(),
              bind2nd(mem_fun(&Workspace::lowerWindow), win));
+    m_sticky.lower(win);
 }
 
 void FbPager::load(const std::string &filename) {
@@ -979,19 +1178,54 @@ void FbPager::load(const std::string &filename) {
 
     m_window.setAlpha(*m_alpha);
     m_window.setBackgroundColor(FbTk::Color((*m_color_str).c_str(), m_window.screenNumber()));
+    updateFrameRate();
+    m_icons.setBudget(std::max(*m_icon_cache_size, 0) * 1024);
+    m_icons.setDiskBudget(std::max(*m_icon_disk_cache_size, 0) * 1024);
+    m_thumbnails.setInterval(std::max(*m_thumbnail_interval, 0));
+    m_thumbnails.setEnabled(*m_window_thumbnails);
+    m_sticky.setBorderWidth(std::max(*m_window_border_width, 0));
     FbTk::Color bgcolor(m_background_color_str->c_str(), m_window.screenNumber());
     for (size_t workspace = 0; workspace < m_workspaces.size(); ++workspace) {
+        m_workspaces[workspace]->setSingleWindow(*m_single_window);
+        m_workspaces[workspace]->setUseBuffer(*m_workspace_buffer || *m_single_window);
         m_workspaces[workspace]->setAlpha(*m_alpha);
         m_workspaces[workspace]->setWindowColor(*m_focused_window_color_str,
                                                 *m_window_color_str,
                                                 *m_window_bordercolor_str);
-        m_workspaces[workspace]->window().setBackgroundColor(bgcolor);
+        m_workspaces[workspace]->setBackgroundColor(bgcolor);
     }
+    updateSnapshots();
+}
+
+void FbPager::updateSnapshots() {
+    if (!*m_workspace_snapshots) {
+        m_snapshot_timer.stop();
+        for_each(m_workspaces.begin(), m_workspaces.end(),
+                 mem_fun(&Workspace::dropSnapshot));
+        return;
+    }
+
+    for (size_t workspace = 0; workspace < m_workspaces.size(); ++workspace)
+        m_workspaces[workspace]->showSnapshot(workspace != m_curr_workspace);
+
+    // the screen is only grabbed while it shows the current workspace,
+    // once we are told about a switch it already shows the next one
+    m_snapshot_timer.setTimeout(std::max(*m_snapshot_interval, 100));
+    m_snapshot_timer.start();
+}
+
+void FbPager::takeSnapshot() {
+    if (m_curr_workspace < m_workspaces.size())
+        m_workspaces[m_curr_workspace]->takeSnapshot(m_rootwin);
+}
 
+void FbPager::updateFrameRate() {
+    FbTk::RedrawScheduler::instance()->setMaxFps(*m_max_fps);
+    m_motion_timer.setTimeout(*m_max_fps > 0 ? 1000 / *m_max_fps : 0);
 }
 
 void FbPager::clearWindows() {
-    m_window.clear();
+    FbTk::RedrawScheduler::instance()->markDirty(m_window);
     for_each(m_workspaces.begin(),
              m_workspaces.end(),
              mem_fun(&Workspace::clearWindows));
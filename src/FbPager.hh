@@ -28,10 +28,17 @@
 #include "FbTk/EventHandler.hh"
 #include "FbTk/Resource.hh"
 #include "FbTk/NotCopyable.hh"
+#include "FbTk/Timer.hh"
+#include "FbTk/SimpleCommand.hh"
 
 #include "ClientWindow.hh"
 #include "FbRootWindow.hh"
 #include "Pager.hh"
+#include "WindowIndex.hh"
+#include "GeometryCache.hh"
+#include "IconCache.hh"
+#include "Thumbnails.hh"
+#include "StickyLayer.hh"
 
 #include <vector>
 #include <list>
@@ -84,20 +91,29 @@ public:
         return true;
     }
 
-    void eraseAllWindows();
-
     void addWindows(const WindowsAndWorkspaces& windows);
 
 private:
     void clientMessageEvent(XClientMessageEvent &event);
     void propertyEvent(XPropertyEvent &event);
     void clearWindows();
-
+    /// applies frame rate resource to redraws and drags
+    void updateFrameRate();
+    /// applies the snapshot resources to the workspaces
+    void updateSnapshots();
+    /// keeps a scaled copy of the screen for the current workspace
+    void takeSnapshot();
+    /// moves the dragged window according to a motion event
+    void dragWindow(XMotionEvent &event);
+    /// applies the newest motion that arrived during the last frame
+    void flushMotion();
 
     void alignWorkspaces();
 
     void sendChangeToWorkspace(unsigned int num);
     void updateWindowHints(Window win);
+    /// @return true if win is shown, but not on workspace_num
+    bool movedWorkspace(Window win, unsigned int workspace_num) const;
     void load(const std::string &filename);
 
     FbRootWindow m_rootwin;
@@ -110,6 +126,11 @@ private:
     ClientHandlerList m_clienthandlers;
     WorkspaceList m_workspaces;
     WindowList m_windows;
+    WindowIndex m_index; ///< finds workspaces and mini windows from X windows
+    GeometryCache m_geometry; ///< client geometry, fed by events
+    IconCache m_icons; ///< scaled client icons
+    Thumbnails m_thumbnails; ///< scaled client window content
+    StickyLayer m_sticky; ///< sticky clients in single window mode
 
     unsigned int m_curr_workspace;
 
@@ -148,7 +169,16 @@ private:
     FbTk::Resource<std::string> m_background_color_str;
     FbTk::Resource<std::string> m_current_background_color_str;
     FbTk::Resource<int>         m_multiclick_time;
+    FbTk::Resource<int>         m_max_fps;
     FbTk::Resource<bool>        m_window_icons;
+    FbTk::Resource<bool>        m_workspace_buffer;
+    FbTk::Resource<bool>        m_single_window; ///< draw mini windows without windows
+    FbTk::Resource<int>         m_icon_cache_size; ///< in kilobytes
+    FbTk::Resource<int>         m_icon_disk_cache_size; ///< in kilobytes
+    FbTk::Resource<bool>        m_window_thumbnails;
+    FbTk::Resource<int>         m_thumbnail_interval; ///< in milliseconds
+    FbTk::Resource<bool>        m_workspace_snapshots;
+    FbTk::Resource<int>         m_snapshot_interval; ///< in milliseconds
     FbTk::Resource<int>         m_window_border_width;
     FbTk::Resource<int> m_workspace_border_width;
     FbTk::Resource<int> m_workspace_border_inactive_width;
@@ -158,6 +188,12 @@ private:
     XButtonEvent                m_last_button_event;
     int                         m_last_workspace_num;
 
+    XMotionEvent                m_motion; ///< newest motion during drag
+    bool                        m_motion_pending;
+    FbTk::SimpleCommand<FbPager> m_motion_cmd;
+    FbTk::Timer                 m_motion_timer; ///< limits drag updates to one per frame
+    FbTk::SimpleCommand<FbPager> m_snapshot_cmd;
+    FbTk::Timer                 m_snapshot_timer; ///< refreshes the current workspace's snapshot
 };
 
 } // end namespace FbPager
@@ -0,0 +1,211 @@
+// AlphaBlend.cc for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include "AlphaBlend.hh"
+#include "PixelUtil.hh"
+
+#include <X11/Xutil.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif // __AVX2__
+
+#include <algorithm>
+
+namespace {
+
+using FbTk::PixelUtil::Channel;
+using FbTk::PixelUtil::div255;
+using FbTk::PixelUtil::nativeByteOrder;
+
+#ifdef __SSE2__
+inline __m128i div255(__m128i x) {
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+/// blends 16 bytes
+inline __m128i blendBytes(__m128i s, __m128i d, __m128i alpha, __m128i inv_alpha) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), alpha),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv_alpha));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), alpha),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv_alpha));
+    return _mm_packus_epi16(div255(lo), div255(hi));
+}
+#endif // __SSE2__
+
+#ifdef __AVX2__
+inline __m256i div255(__m256i x) {
+    x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+/// blends 32 bytes, unpack and pack work within 128 bit lanes so the order is kept
+inline __m256i blendBytes(__m256i s, __m256i d, __m256i alpha, __m256i inv_alpha) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(s, zero), alpha),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(d, zero), inv_alpha));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(s, zero), alpha),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(d, zero), inv_alpha));
+    return _mm256_packus_epi16(div255(lo), div255(hi));
+}
+#endif // __AVX2__
+
+/**
+   Blends bytes, works for any 32 bit format with 8 bit channels.
+   The pad byte is blended too, it isn't shown anyway.
+*/
+void blendRow32(unsigned char *dest, const unsigned char *src,
+                unsigned int num_bytes, unsigned int alpha) {
+    unsigned int i = 0;
+#ifdef __AVX2__
+    const __m256i alpha256 = _mm256_set1_epi16(alpha);
+    const __m256i inv_alpha256 = _mm256_set1_epi16(255 - alpha);
+    for (; i + 32 <= num_bytes; i += 32) {
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dest + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + i),
+                            blendBytes(s, d, alpha256, inv_alpha256));
+    }
+#endif // __AVX2__
+#ifdef __SSE2__
+    const __m128i alpha128 = _mm_set1_epi16(alpha);
+    const __m128i inv_alpha128 = _mm_set1_epi16(255 - alpha);
+    for (; i + 16 <= num_bytes; i += 16) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dest + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i),
+                         blendBytes(s, d, alpha128, inv_alpha128));
+    }
+#endif // __SSE2__
+    for (; i < num_bytes; ++i)
+        dest[i] = div255(src[i] * alpha + dest[i] * (255 - alpha));
+}
+
+/**
+   Blends 16 bit pixels in native byte order, channel by channel.
+   alpha is scaled to 0-256 so the products fit in 16 bits.
+*/
+void blendRow16(unsigned short *dest, const unsigned short *src,
+                unsigned int width, unsigned int alpha,
+                const Channel *channels) {
+    alpha += alpha >> 7;
+    unsigned int x = 0;
+#ifdef __SSE2__
+    const __m128i alpha128 = _mm_set1_epi16(alpha);
+    const __m128i inv_alpha128 = _mm_set1_epi16(256 - alpha);
+    for (; x + 8 <= width; x += 8) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dest + x));
+        __m128i result = _mm_setzero_si128();
+        for (int c = 0; c < 3; ++c) {
+            const __m128i shift = _mm_cvtsi32_si128(channels[c].shift);
+            const __m128i max = _mm_set1_epi16(channels[c].max);
+            __m128i cs = _mm_and_si128(_mm_srl_epi16(s, shift), max);
+            __m128i cd = _mm_and_si128(_mm_srl_epi16(d, shift), max);
+            __m128i mix = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(cs, alpha128),
+                                                       _mm_mullo_epi16(cd, inv_alpha128)), 8);
+            result = _mm_or_si128(result, _mm_sll_epi16(mix, shift));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + x), result);
+    }
+#endif // __SSE2__
+    for (; x < width; ++x) {
+        unsigned int result = 0;
+        for (int c = 0; c < 3; ++c) {
+            unsigned int cs = (src[x] >> channels[c].shift) & channels[c].max;
+            unsigned int cd = (dest[x] >> channels[c].shift) & channels[c].max;
+            result |= ((cs * alpha + cd * (256 - alpha)) >> 8) << channels[c].shift;
+        }
+        dest[x] = result;
+    }
+}
+
+} // end anonymous namespace
+
+namespace FbTk {
+
+namespace AlphaBlend {
+
+void blend(XImage &dest, const XImage &src, unsigned char alpha) {
+    unsigned int width = std::min(dest.width, src.width);
+    unsigned int height = std::min(dest.height, src.height);
+
+    Channel channels[3] = {
+        Channel(dest.red_mask), Channel(dest.green_mask), Channel(dest.blue_mask)
+    };
+
+    bool byte_channels = true;
+    for (int c = 0; c < 3; ++c) {
+        if (channels[c].max != 0xFF || channels[c].shift % 8 != 0)
+            byte_channels = false;
+    }
+
+    if (dest.bits_per_pixel == 32 && src.bits_per_pixel == 32 && byte_channels) {
+        for (unsigned int y = 0; y < height; ++y) {
+            blendRow32(reinterpret_cast<unsigned char *>(dest.data + y * dest.bytes_per_line),
+                       reinterpret_cast<const unsigned char *>(src.data + y * src.bytes_per_line),
+                       width * 4, alpha);
+        }
+        return;
+    }
+
+    const int byte_order = nativeByteOrder();
+    if (dest.bits_per_pixel == 16 && src.bits_per_pixel == 16 &&
+        dest.byte_order == byte_order && src.byte_order == byte_order &&
+        channels[0].max != 0 && channels[1].max != 0 && channels[2].max != 0 &&
+        channels[0].max <= 0xFF && channels[1].max <= 0xFF && channels[2].max <= 0xFF) {
+        for (unsigned int y = 0; y < height; ++y) {
+            blendRow16(reinterpret_cast<unsigned short *>(dest.data + y * dest.bytes_per_line),
+                       reinterpret_cast<const unsigned short *>(src.data + y * src.bytes_per_line),
+                       width, alpha, channels);
+        }
+        return;
+    }
+
+    // we need the masks to find the channels
+    if (channels[0].max == 0 || channels[1].max == 0 || channels[2].max == 0)
+        return;
+
+    // any other format, one pixel at a time
+    XImage &source = const_cast<XImage &>(src);
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x) {
+            unsigned long s = XGetPixel(&source, x, y);
+            unsigned long d = XGetPixel(&dest, x, y);
+            unsigned long result = 0;
+            for (int c = 0; c < 3; ++c) {
+                unsigned long cs = (s >> channels[c].shift) & channels[c].max;
+                unsigned long cd = (d >> channels[c].shift) & channels[c].max;
+                result |= ((cs * alpha + cd * (255 - alpha) + 127) / 255) << channels[c].shift;
+            }
+            XPutPixel(&dest, x, y, result);
+        }
+    }
+}
+
+} // end namespace AlphaBlend
+
+} // end namespace FbTk
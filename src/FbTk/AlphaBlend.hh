@@ -0,0 +1,46 @@
+// AlphaBlend.hh for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FBTK_ALPHABLEND_HH
+#define FBTK_ALPHABLEND_HH
+
+#include <X11/Xlib.h>
+
+namespace FbTk {
+
+/// Software blending of client side images, used when RENDER is missing
+namespace AlphaBlend {
+
+/**
+   Blends src into dest, for each color channel:
+   dest = (src * alpha + dest * (255 - alpha)) / 255
+   Both images must be ZPixmap images of the same visual,
+   with the color masks of dest set.
+   32 and 16 bits per pixel use SSE2 or AVX2 when the compiler
+   targets them, other formats go pixel by pixel.
+*/
+void blend(XImage &dest, const XImage &src, unsigned char alpha);
+
+} // end namespace AlphaBlend
+
+} // end namespace FbTk
+
+#endif // FBTK_ALPHABLEND_HH
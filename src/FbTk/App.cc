@@ -22,9 +22,58 @@
 #include "App.hh"
 
 #include "EventManager.hh"
+#include "Timer.hh"
+#include "Command.hh"
 
 #include <cassert>
 #include <string>
+#include <set>
+#include <algorithm>
+
+#include <poll.h>
+
+namespace {
+
+/// identifies events that replace each other
+struct FoldKey {
+    FoldKey(Window w, int t, unsigned long d):win(w), type(t), detail(d) { }
+    bool operator < (const FoldKey &other) const {
+        if (win != other.win)
+            return win < other.win;
+        if (type != other.type)
+            return type < other.type;
+        return detail < other.detail;
+    }
+    Window win;
+    int type;
+    unsigned long detail;
+};
+
+/**
+   @return true if only the newest event with the same key is
+   of interest, and sets key
+   @param segment counts the button events seen so far, motion
+   is never folded across a button press or release
+*/
+bool foldable(const XEvent &ev, unsigned long segment, FoldKey &key) {
+    switch (ev.type) {
+    case MotionNotify:
+        key = FoldKey(ev.xmotion.window, ev.type, segment);
+        return true;
+    case ConfigureNotify:
+        // synthetic events from the window manager carry root
+        // coordinates, so don't mix them with real ones
+        key = FoldKey(ev.xconfigure.window, ev.type, ev.xconfigure.send_event);
+        return true;
+    case PropertyNotify:
+        key = FoldKey(ev.xproperty.window, ev.type, ev.xproperty.atom);
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // end anonymous namespace
 
 namespace FbTk {
 
@@ -36,7 +85,8 @@ App *App::instance() {
     return s_app;
 }
 
-App::App(const char *displayname):m_done(false), m_display(0) {
+App::App(const char *displayname):m_done(false), m_display(0),
+                                   m_folded_events(0), m_dispatched_events(0) {
     if (s_app != 0)
         throw std::string("Can't create more than one instance of FbTk::App");
     s_app = this;
@@ -60,10 +110,120 @@ void App::sync(bool discard) {
 }
 
 void App::eventLoop() {
-    XEvent ev;
     while (!m_done) {
+        handleQueuedEvents();
+        Timer::updateTimers();
+        if (m_done)
+            break;
+        // timers might have generated new events
+        if (XPending(display()))
+            continue;
+
+        runIdleCommands();
+        if (m_done)
+            break;
+        // poll can't see events that Xlib already has queued
+        if (XPending(display()))
+            continue;
+
+        waitForEvents();
+    }
+}
+
+void App::waitForEvents() {
+    std::vector<pollfd> fds(1 + m_fd_handlers.size());
+    fds[0].fd = ConnectionNumber(display());
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    FdHandlers::iterator it = m_fd_handlers.begin();
+    FdHandlers::iterator it_end = m_fd_handlers.end();
+    for (size_t i = 1; it != it_end; ++it, ++i) {
+        fds[i].fd = it->first;
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+
+    // -1 sleeps until something happens
+    if (poll(&fds[0], fds.size(), Timer::nextTimeout()) <= 0)
+        return; // timeout or EINTR, timers are updated by the caller
+
+    for (size_t i = 1; i < fds.size() && !m_done; ++i) {
+        if (fds[i].revents == 0)
+            continue;
+        // the command might have removed itself or others
+        it = m_fd_handlers.find(fds[i].fd);
+        if (it != m_fd_handlers.end())
+            it->second->execute();
+    }
+}
+
+void App::runIdleCommands() {
+    if (m_idle_commands.empty())
+        return;
+    // copy so commands can remove themselves
+    CommandList commands(m_idle_commands);
+    CommandList::iterator it = commands.begin();
+    CommandList::iterator it_end = commands.end();
+    for (; it != it_end; ++it) {
+        if (find(m_idle_commands.begin(), m_idle_commands.end(), *it) !=
+            m_idle_commands.end())
+            (*it)->execute();
+    }
+}
+
+void App::addFdHandler(int fd, Command &cmd) {
+    if (fd >= 0)
+        m_fd_handlers[fd] = &cmd;
+}
+
+void App::removeFdHandler(int fd) {
+    m_fd_handlers.erase(fd);
+}
+
+void App::addIdleCommand(Command &cmd) {
+    if (find(m_idle_commands.begin(), m_idle_commands.end(), &cmd) ==
+        m_idle_commands.end())
+        m_idle_commands.push_back(&cmd);
+}
+
+void App::removeIdleCommand(Command &cmd) {
+    m_idle_commands.remove(&cmd);
+}
+
+void App::handleQueuedEvents() {
+    m_batch.clear();
+    XEvent ev;
+    // XPending flushes the output buffer and reads from the connection
+    while (XPending(display())) {
         XNextEvent(display(), &ev);
-        EventManager::instance()->handleEvent(ev);
+        m_batch.push_back(ev);
+    }
+
+    if (m_batch.empty())
+        return;
+
+    // walk backwards so the newest event of each key survives
+    std::vector<bool> folded(m_batch.size(), false);
+    std::set<FoldKey> seen;
+    FoldKey key(None, 0, 0);
+    unsigned long segment = 0;
+    for (size_t i = m_batch.size(); i > 0; --i) {
+        const int type = m_batch[i - 1].type;
+        if (type == ButtonPress || type == ButtonRelease)
+            ++segment;
+        if (!foldable(m_batch[i - 1], segment, key))
+            continue;
+        if (!seen.insert(key).second) {
+            folded[i - 1] = true;
+            ++m_folded_events;
+        }
+    }
+
+    for (size_t i = 0; i < m_batch.size() && !m_done; ++i) {
+        if (folded[i])
+            continue;
+        ++m_dispatched_events;
+        EventManager::instance()->handleEvent(m_batch[i]);
     }
 }
 
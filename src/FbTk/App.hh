@@ -24,8 +24,14 @@
 
 #include <X11/Xlib.h>
 
+#include <vector>
+#include <map>
+#include <list>
+
 namespace FbTk {
 
+class Command;
+
 ///   Main class for applications, every application must create an instance of this class
 /**
  * Usage: \n
@@ -37,6 +43,15 @@ namespace FbTk {
  * app.eventLoop(); \n
  *
  * To end main loop you call App::instance()->end()
+ *
+ * The event loop reads all queued events at once and folds events
+ * that only carry state (ConfigureNotify, PropertyNotify, MotionNotify)
+ * so that only the newest one for each window (and atom) is dispatched.
+ * Motion events are not folded across button events.
+ *
+ * Besides X events the loop drives Timer objects, commands
+ * registered for file descriptors and idle commands. It sleeps
+ * in poll() until one of them has something to do.
  */
 class App {
 public:
@@ -53,10 +68,32 @@ public:
     /// forces an end to event loop
     void end();
     bool done() const { return m_done; }
+    /// executes cmd when fd becomes readable, cmd is not owned
+    void addFdHandler(int fd, Command &cmd);
+    void removeFdHandler(int fd);
+    /// executes cmd each time all pending events have been handled, cmd is not owned
+    void addIdleCommand(Command &cmd);
+    void removeIdleCommand(Command &cmd);
+    /// @return number of events dropped because a newer event replaced them
+    unsigned long foldedEvents() const { return m_folded_events; }
+    /// @return number of events handed to the EventManager
+    unsigned long dispatchedEvents() const { return m_dispatched_events; }
 private:
+    /// reads all pending events, folds duplicates and dispatches the rest
+    void handleQueuedEvents();
+    /// sleeps until the X connection, a fd handler or a timer needs attention
+    void waitForEvents();
+    void runIdleCommands();
+
     static App *s_app;
     bool m_done;
     Display *m_display;
+    std::vector<XEvent> m_batch; ///< events read in one pass
+    typedef std::map<int, Command *> FdHandlers;
+    FdHandlers m_fd_handlers;
+    typedef std::list<Command *> CommandList;
+    CommandList m_idle_commands;
+    unsigned long m_folded_events, m_dispatched_events;
 };
 
 } // end namespace FbTk
@@ -23,7 +23,6 @@
 
 #include "EventManager.hh"
 #include "FbWindow.hh"
-#include "App.hh"
 
 #include <iostream>
 using namespace std;
@@ -41,7 +40,14 @@ EventManager::~EventManager() {
 }
 
 void EventManager::handleEvent(XEvent &ev) {
+    // keep our copy of the window tree up to date
+    if (ev.type == ReparentNotify)
+        setParentWindow(ev.xreparent.window, ev.xreparent.parent);
+
     dispatch(ev.xany.window, ev);
+
+    if (ev.type == DestroyNotify)
+        removeParentWindow(ev.xdestroywindow.window);
 }
 
 void EventManager::add(EventHandler &ev, const FbWindow &win) {
@@ -121,13 +127,26 @@ void EventManager::unregisterEventHandler(Window win) {
     }
 }
 
+void EventManager::setParentWindow(Window win, Window parent) {
+    if (win != None)
+        m_parent_windows[win] = parent;
+}
+
+void EventManager::removeParentWindow(Window win) {
+    m_parent_windows.erase(win);
+}
+
 void EventManager::dispatch(Window win, XEvent &ev, bool parent) {
     EventHandler *evhand = 0;
-    if (parent)
-        evhand = m_parent[win];
-    else {
+    if (parent) {
+        EventHandlerMap::iterator it = m_parent.find(win);
+        if (it != m_parent.end())
+            evhand = it->second;
+    } else {
         win = getEventWindow(ev);
-        evhand = m_eventhandlers[win];
+        EventHandlerMap::iterator it = m_eventhandlers.find(win);
+        if (it != m_eventhandlers.end())
+            evhand = it->second;
     }
 
     if (evhand == 0)
@@ -165,22 +184,14 @@ void EventManager::dispatch(Window win, XEvent &ev, bool parent) {
 
     // find out which window is the parent and 
     // dispatch event
-    Window root, parent_win, *children = 0;
-    unsigned int num_children;
-    if (XQueryTree(FbTk::App::instance()->display(), win, 
-                   &root, &parent_win, &children, &num_children) != 0) {
-        if (children != 0) 
-            XFree(children);
-
-        if (parent_win != 0 &&
-            parent_win != root) {
-            if (m_parent[parent_win] == 0)
-                return;
-
-            // dispatch event to parent
-            dispatch(parent_win, ev, true);
-        }
-    }
+    std::map<Window, Window>::iterator parent_it = m_parent_windows.find(win);
+    if (parent_it == m_parent_windows.end() ||
+        parent_it->second == None ||
+        m_parent.find(parent_it->second) == m_parent.end())
+        return;
+
+    // dispatch event to parent
+    dispatch(parent_it->second, ev, true);
 
 }
 
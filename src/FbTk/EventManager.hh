@@ -49,12 +49,19 @@ public:
 
     void registerEventHandler(EventHandler &ev, Window win);
     void unregisterEventHandler(Window win);
+
+    /// remember the parent of win so events can be passed on without a server round-trip
+    void setParentWindow(Window win, Window parent);
+    void removeParentWindow(Window win);
 private:
     EventManager() { }
     ~EventManager();
     void dispatch(Window win, XEvent &event, bool parent = false);
-    std::map<Window, EventHandler *> m_eventhandlers;
-    std::map<Window, EventHandler *> m_parent;
+    typedef std::map<Window, EventHandler *> EventHandlerMap;
+    EventHandlerMap m_eventhandlers;
+    EventHandlerMap m_parent;
+    /// client side copy of the window tree (window -> parent window)
+    std::map<Window, Window> m_parent_windows;
 };
 
 } //end namespace FbTk
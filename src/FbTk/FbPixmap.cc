@@ -25,10 +25,156 @@
 #include "App.hh"
 #include "GContext.hh"
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "Transparent.hh"
+#include "ImageBuffer.hh"
+#include "ImageScaler.hh"
+
 #include <X11/Xutil.h>
+#ifdef HAVE_XRENDER
+#include <X11/extensions/Xrender.h>
+#endif // HAVE_XRENDER
+
 #include <iostream>
+#include <vector>
 using namespace std;
 
+namespace {
+
+/// pixels read from the pixmap being transformed
+FbTk::ImageBuffer &sourceBuffer() {
+    static FbTk::ImageBuffer buffer;
+    return buffer;
+}
+
+/// pixels of the transformed pixmap
+FbTk::ImageBuffer &destBuffer() {
+    static FbTk::ImageBuffer buffer;
+    return buffer;
+}
+
+/// keeps its weights between scales to the same size
+FbTk::ImageScaler &imageScaler() {
+    static FbTk::ImageScaler scaler;
+    return scaler;
+}
+
+#ifdef HAVE_XRENDER
+/// @return render format for pixmaps of depth, 0 if there is none
+XRenderPictFormat *findFormat(int depth) {
+    Display *dpy = FbTk::App::instance()->display();
+    switch (depth) {
+    case 1:
+        return XRenderFindStandardFormat(dpy, PictStandardA1);
+    case 8:
+        return XRenderFindStandardFormat(dpy, PictStandardA8);
+    case 32:
+        return XRenderFindStandardFormat(dpy, PictStandardARGB32);
+    }
+    if (depth == DefaultDepth(dpy, DefaultScreen(dpy)))
+        return XRenderFindVisualFormat(dpy, DefaultVisual(dpy, DefaultScreen(dpy)));
+    return 0;
+}
+
+/**
+   Samples src through transform into dest on the server,
+   src may be a window, its children are included then
+   @return false if there is no render format for depth
+*/
+bool renderTransformed(Drawable src, Drawable dest, int depth,
+                       XTransform &transform, const char *filter,
+                       unsigned int width, unsigned int height,
+                       XFixed *params = 0, int num_params = 0) {
+    Display *dpy = FbTk::App::instance()->display();
+
+    // transforms and filters need RENDER 0.6, pad repeat 0.10
+    static int major = -1, minor = -1;
+    if (major < 0 && !XRenderQueryVersion(dpy, &major, &minor))
+        major = minor = 0;
+    if (major == 0 && minor < 6)
+        return false;
+
+    XRenderPictFormat *format = findFormat(depth);
+    if (format == 0)
+        return false;
+
+    XRenderPictureAttributes attr;
+    attr.subwindow_mode = IncludeInferiors;
+    unsigned long mask = CPSubwindowMode;
+#ifdef RepeatPad
+    if (major > 0 || minor >= 10) {
+        // repeat the edge pixels so filtering doesn't fade out the borders
+        attr.repeat = RepeatPad;
+        mask |= CPRepeat;
+    }
+#endif // RepeatPad
+    Picture src_pic = XRenderCreatePicture(dpy, src, format, mask, &attr);
+    Picture dest_pic = XRenderCreatePicture(dpy, dest, format, 0, 0);
+
+    XRenderSetPictureTransform(dpy, src_pic, &transform);
+    XRenderSetPictureFilter(dpy, src_pic, filter, params, num_params);
+    XRenderComposite(dpy, PictOpSrc,
+                     src_pic, None, dest_pic,
+                     0, 0, // src
+                     0, 0, // mask
+                     0, 0, // dest
+                     width, height);
+
+    XRenderFreePicture(dpy, dest_pic);
+    XRenderFreePicture(dpy, src_pic);
+
+    return true;
+}
+
+/**
+   Box filter kernel covering zoom_x * zoom_y source pixels, odd sized
+   so it stays centered on the sample
+   @return parameters for FilterConvolution
+*/
+std::vector<XFixed> boxKernel(float zoom_x, float zoom_y) {
+    int width = static_cast<int>(zoom_x) | 1;
+    int height = static_cast<int>(zoom_y) | 1;
+    std::vector<XFixed> params(2 + width * height,
+                               XDoubleToFixed(1.0 / (width * height)));
+    params[0] = XDoubleToFixed(width);
+    params[1] = XDoubleToFixed(height);
+    return params;
+}
+#endif // HAVE_XRENDER
+
+/**
+   Scales src into dest, filtered by ImageScaler, box filter
+   when shrinking and bilinear when growing. Formats it can't
+   handle, like bitmaps, take the nearest pixel.
+*/
+void scaleImage(XImage *src, XImage *dest,
+                unsigned int src_width, unsigned int src_height,
+                unsigned int dest_width, unsigned int dest_height) {
+    FbTk::ImageScaler &scaler = imageScaler();
+    scaler.setFilter(dest_width < src_width || dest_height < src_height ?
+                     FbTk::ImageScaler::BOX : FbTk::ImageScaler::BILINEAR);
+    if (scaler.scale(*src, *dest))
+        return;
+
+    float zoom_x = static_cast<float>(src_width)/static_cast<float>(dest_width);
+    float zoom_y = static_cast<float>(src_height)/static_cast<float>(dest_height);
+    float src_x = 0, src_y = 0;
+    for (int tx=0; tx < static_cast<signed>(dest_width); ++tx, src_x += zoom_x) {
+        src_y = 0;
+        for (int ty=0; ty < static_cast<signed>(dest_height); ++ty, src_y += zoom_y) {
+            XPutPixel(dest, tx, ty,
+                      XGetPixel(src,
+                                static_cast<int>(src_x),
+                                static_cast<int>(src_y)));
+        }
+    }
+}
+
+} // end anonymous namespace
+
 namespace FbTk {
 
 FbPixmap::FbPixmap():m_pm(0), 
@@ -169,30 +315,51 @@ void FbPixmap::copy(Pixmap pm) {
 }
 
 void FbPixmap::rotate() {
+    if (drawable() == 0)
+        return;
 
-    Display *dpy = FbTk::App::instance()->display();
-
-    // make an image copy
-    XImage *src_image = XGetImage(dpy, drawable(),
-                                  0, 0, // pos
-                                  width(), height(), // size
-                                  ~0, // plane mask
-                                  ZPixmap); // format
     // reverse height/width for new pixmap
     FbPixmap new_pm(drawable(), height(), width(), depth());
+    if (new_pm.drawable() == 0)
+        return;
 
-    GContext gc(drawable());
-
-    // copy new area
-    for (int y = 0; y < static_cast<signed>(height()); ++y) {
-        for (int x = 0; x < static_cast<signed>(width()); ++x) {
-            gc.setForeground(XGetPixel(src_image, x, y));
-            // revers coordinates
-            XDrawPoint(dpy, new_pm.drawable(), gc.gc(), y, x);
+    bool done = false;
+#ifdef HAVE_XRENDER
+    if (Transparent::haveRender()) {
+        // swap x and y when sampling the source
+        XTransform transform = {{
+            { XDoubleToFixed(0), XDoubleToFixed(1), XDoubleToFixed(0) },
+            { XDoubleToFixed(1), XDoubleToFixed(0), XDoubleToFixed(0) },
+            { XDoubleToFixed(0), XDoubleToFixed(0), XDoubleToFixed(1) }
+        }};
+        done = renderTransformed(drawable(), new_pm.drawable(), depth(),
+                                 transform, FilterNearest,
+                                 new_pm.width(), new_pm.height());
+    }
+#endif // HAVE_XRENDER
+
+    if (!done) {
+        // make an image copy
+        XImage *src_image = sourceBuffer().get(drawable(), depth(),
+                                               0, 0, // pos
+                                               width(), height()); // size
+        if (src_image == 0)
+            return;
+
+        XImage *dest_image = destBuffer().create(depth(), height(), width());
+        if (dest_image == 0)
+            return;
+
+        // reverse coordinates
+        for (int y = 0; y < static_cast<signed>(height()); ++y) {
+            for (int x = 0; x < static_cast<signed>(width()); ++x)
+                XPutPixel(dest_image, y, x, XGetPixel(src_image, x, y));
         }
+
+        GContext gc(new_pm.drawable());
+        destBuffer().put(new_pm.drawable(), gc.gc(), 0, 0);
     }
 
-    XDestroyImage(src_image);
     // free old pixmap and set new from new_pm
     free();
 
@@ -203,41 +370,51 @@ void FbPixmap::rotate() {
 }
 
 void FbPixmap::scale(unsigned int dest_width, unsigned int dest_height) {
-    if (drawable() == 0 || 
+    if (drawable() == 0 || dest_width == 0 || dest_height == 0 ||
         (dest_width == width() && dest_height == height()))
         return;
 
-    Display *dpy = FbTk::App::instance()->display();
-
-    XImage *src_image = XGetImage(dpy, drawable(),
-                                  0, 0, // pos
-                                  width(), height(), // size
-                                  ~0, // plane mask
-                                  ZPixmap); // format
-    if (src_image == 0)
-        return;
-
     // create new pixmap with dest size
     FbPixmap new_pm(drawable(), dest_width, dest_height, depth());
+    if (new_pm.drawable() == 0)
+        return;
 
-    GContext gc(drawable());
-    // calc zoom
-    float zoom_x = static_cast<float>(width())/static_cast<float>(dest_width);
-    float zoom_y = static_cast<float>(height())/static_cast<float>(dest_height);
-
-    // start scaling
-    float src_x = 0, src_y = 0;
-    for (int tx=0; tx < static_cast<signed>(dest_width); ++tx, src_x += zoom_x) {
-        src_y = 0;
-        for (int ty=0; ty < static_cast<signed>(dest_height); ++ty, src_y += zoom_y) {	
-            gc.setForeground(XGetPixel(src_image,
-                                       static_cast<int>(src_x),
-                                       static_cast<int>(src_y)));
-            XDrawPoint(dpy, new_pm.drawable(), gc.gc(), tx, ty);
-        }
+    bool done = false;
+#ifdef HAVE_XRENDER
+    if (Transparent::haveRender()) {
+        float zoom_x = static_cast<float>(width())/static_cast<float>(dest_width);
+        float zoom_y = static_cast<float>(height())/static_cast<float>(dest_height);
+        XTransform transform = {{
+            { XDoubleToFixed(zoom_x), XDoubleToFixed(0), XDoubleToFixed(0) },
+            { XDoubleToFixed(0), XDoubleToFixed(zoom_y), XDoubleToFixed(0) },
+            { XDoubleToFixed(0), XDoubleToFixed(0), XDoubleToFixed(1) }
+        }};
+        // bitmaps can't be filtered
+        done = renderTransformed(drawable(), new_pm.drawable(), depth(),
+                                 transform,
+                                 depth() == 1 ? FilterNearest : FilterBilinear,
+                                 dest_width, dest_height);
     }
+#endif // HAVE_XRENDER
+
+    if (!done) {
+        XImage *src_image = sourceBuffer().get(drawable(), depth(),
+                                               0, 0, // pos
+                                               width(), height()); // size
+        if (src_image == 0)
+            return;
+
+        XImage *dest_image = destBuffer().create(depth(), dest_width, dest_height);
+        if (dest_image == 0)
+            return;
+
+        scaleImage(src_image, dest_image,
+                   width(), height(), dest_width, dest_height);
 
-    XDestroyImage(src_image);
+        // upload the whole image with one request
+        GContext gc(new_pm.drawable());
+        destBuffer().put(new_pm.drawable(), gc.gc(), 0, 0);
+    }
 
     // free old pixmap and set new from new_pm
     free();
@@ -248,6 +425,58 @@ void FbPixmap::scale(unsigned int dest_width, unsigned int dest_height) {
     m_pm = new_pm.release();
 }
 
+void FbPixmap::copyScaled(Drawable src, int src_x, int src_y,
+                          unsigned int src_width, unsigned int src_height) {
+    if (drawable() == 0 || src == 0 || src_width == 0 || src_height == 0)
+        return;
+
+    bool done = false;
+#ifdef HAVE_XRENDER
+    if (Transparent::haveRender()) {
+        float zoom_x = static_cast<float>(src_width)/static_cast<float>(width());
+        float zoom_y = static_cast<float>(src_height)/static_cast<float>(height());
+        XTransform transform = {{
+            { XDoubleToFixed(zoom_x), XDoubleToFixed(0), XDoubleToFixed(src_x) },
+            { XDoubleToFixed(0), XDoubleToFixed(zoom_y), XDoubleToFixed(src_y) },
+            { XDoubleToFixed(0), XDoubleToFixed(0), XDoubleToFixed(1) }
+        }};
+        if (depth() == 1) {
+            done = renderTransformed(src, drawable(), depth(), transform,
+                                     FilterNearest, width(), height());
+        } else if (zoom_x > 2 || zoom_y > 2) {
+            // bilinear reads only 4 source pixels and aliases when
+            // shrinking this much, average all of them instead
+            std::vector<XFixed> kernel = boxKernel(zoom_x, zoom_y);
+            done = renderTransformed(src, drawable(), depth(), transform,
+                                     FilterConvolution, width(), height(),
+                                     &kernel[0], kernel.size());
+        } else {
+            done = renderTransformed(src, drawable(), depth(), transform,
+                                     FilterBilinear, width(), height());
+        }
+    }
+#endif // HAVE_XRENDER
+
+    if (!done) {
+        // only the source area is read, usually the whole screen, so the
+        // segment is freed afterwards instead of kept in sourceBuffer()
+        ImageBuffer source;
+        XImage *src_image = source.get(src, depth(),
+                                       src_x, src_y,
+                                       src_width, src_height);
+        XImage *dest_image = src_image == 0 ? 0 :
+            destBuffer().create(depth(), width(), height());
+        if (dest_image != 0) {
+            scaleImage(src_image, dest_image,
+                       src_width, src_height, width(), height());
+
+            GContext gc(drawable());
+            destBuffer().put(drawable(), gc.gc(), 0, 0);
+        }
+        source.release();
+    }
+}
+
 void FbPixmap::resize(unsigned int width, unsigned int height) {
     FbPixmap pm(drawable(), width, height, depth());
     *this = pm.release();
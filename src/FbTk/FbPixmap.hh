@@ -51,8 +51,17 @@ public:
     void copy(Pixmap pixmap);
     /// rotates the pixmap 90 deg, not implemented!
     void rotate();
-    /// scales the pixmap to specified size
+    /**
+       scales the pixmap to specified size,
+       on the server with RENDER if possible
+    */
     void scale(unsigned int width, unsigned int height);
+    /**
+       replaces the content with an area of src scaled to the size of
+       the pixmap, src can be a window. Only the scaled copy is kept
+    */
+    void copyScaled(Drawable src, int src_x, int src_y,
+                    unsigned int src_width, unsigned int src_height);
     void resize(unsigned int width, unsigned int height);
     /// drops pixmap and returns it
     Pixmap release();
@@ -27,44 +27,21 @@
 #include "Color.hh"
 #include "App.hh"
 #include "Transparent.hh"
+#include "RedrawScheduler.hh"
+#include "RootPixmap.hh"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif // HAVE_CONFIG_H
 
-#include <X11/Xatom.h>
 
 #include <cassert>
 #include <iostream>
+#include <algorithm>
 using namespace std;
 
 namespace FbTk {
 
-namespace {
-Pixmap getRootPixmap(int screen_num) {
-    Pixmap root_pm = 0;
-    // get root pixmap for transparency
-    Display *disp = FbTk::App::instance()->display();
-    Atom real_type;
-    int real_format;
-    unsigned long items_read, items_left;
-    unsigned int *data;
-    if (XGetWindowProperty(disp, RootWindow(disp, screen_num), 
-                           XInternAtom(disp, "_XROOTPMAP_ID", false),
-                           0L, 1L, 
-                           false, XA_PIXMAP, &real_type,
-                           &real_format, &items_read, &items_left, 
-                           (unsigned char **) &data) == Success && 
-        items_read) { 
-        root_pm = (Pixmap) (*data);                  
-        XFree(data);
-    }
-
-    return root_pm; 
-}
-
-}; // end anonymous namespace
-
 Display *FbWindow::s_display = 0;
 
 FbWindow::FbWindow():m_parent(0), m_screen_num(0), m_window(0), m_x(0), m_y(0), 
@@ -138,8 +115,10 @@ FbWindow::FbWindow(Window client):m_parent(0),
 }
 
 FbWindow::~FbWindow() {
+    FbTk::RedrawScheduler::instance()->remove(*this);
     if (m_window != 0 && m_destroy) {
         FbTk::EventManager::instance()->remove(m_window);
+        FbTk::EventManager::instance()->removeParentWindow(m_window);
         XDestroyWindow(s_display, m_window);
     }
 }
@@ -172,18 +151,58 @@ void FbWindow::setEventMask(long mask) {
 
 void FbWindow::clear() {
     XClearWindow(s_display, m_window);
-    updateTransparent();
+    // the buffer already holds the transparency
+    if (m_buffer_pm == 0)
+        updateTransparent();
 }
 
 void FbWindow::clearArea(int x, int y, 
                          unsigned int width, unsigned int height, 
                          bool exposures) {
     XClearArea(s_display, window(), x, y, width, height, exposures);
-    updateTransparent(x, y, width, height);
+    if (m_buffer_pm == 0)
+        updateTransparent(x, y, width, height);
+}
+
+void FbWindow::clearArea(XRectangle *rects, int num_rects) {
+    for (int i = 0; i < num_rects; ++i) {
+        XClearArea(s_display, window(),
+                   rects[i].x, rects[i].y,
+                   rects[i].width, rects[i].height, False);
+    }
+    if (m_buffer_pm == 0)
+        updateTransparent(rects, num_rects);
+}
+
+void FbWindow::updateTransparent(XRectangle *rects, int num_rects) {
+    if (num_rects <= 0 || rects == 0 || !m_transparent.get())
+        return;
+
+    if (num_rects == 1) {
+        updateTransparent(rects[0].x, rects[0].y,
+                          rects[0].width, rects[0].height);
+        return;
+    }
+
+    // one composite of the bounding box, clipped to the rectangles
+    int x1 = rects[0].x, y1 = rects[0].y;
+    int x2 = x1 + rects[0].width, y2 = y1 + rects[0].height;
+    for (int i = 1; i < num_rects; ++i) {
+        x1 = std::min(x1, static_cast<int>(rects[i].x));
+        y1 = std::min(y1, static_cast<int>(rects[i].y));
+        x2 = std::max(x2, rects[i].x + static_cast<int>(rects[i].width));
+        y2 = std::max(y2, rects[i].y + static_cast<int>(rects[i].height));
+    }
+
+    // the clip belongs to the destination picture, so make sure
+    // it's up to date before we set the clip
+    updateTransparentTarget();
+    m_transparent->setClipRectangles(rects, num_rects);
+    updateTransparent(x1, y1, x2 - x1, y2 - y1);
+    m_transparent->setClipRectangles(0, 0);
 }
 
 void FbWindow::updateTransparent(int the_x, int the_y, unsigned int the_width, unsigned int the_height) {
-#ifdef HAVE_XRENDER
     if (width() == 0 || height() == 0)
         return;
 
@@ -200,17 +219,7 @@ void FbWindow::updateTransparent(int the_x, int the_y, unsigned int the_width, u
     if (!m_transparent.get())
         return;
 
-    // update source and destination if needed
-    Pixmap root = getRootPixmap(screenNumber());
-    if (m_transparent->source() != root)
-        m_transparent->setSource(root, screenNumber());
-
-    if (m_buffer_pm) {
-        if (m_transparent->dest() != m_buffer_pm) {
-            m_transparent->setDest(m_buffer_pm, screenNumber());
-        }
-    } else if (m_transparent->dest() != window())
-        m_transparent->setDest(window(), screenNumber());
+    updateTransparentTarget();
 
     const FbWindow *root_parent = parent();
     // our position in parent ("root")
@@ -243,18 +252,29 @@ void FbWindow::updateTransparent(int the_x, int the_y, unsigned int the_width, u
     m_transparent->render(root_x + the_x, root_y + the_y,
                           the_x, the_y,
                           the_width, the_height);
-#endif // HAVE_XRENDER
+}
+
+void FbWindow::updateTransparentTarget() {
+    // update source and destination if needed
+    Pixmap root = RootPixmap::instance()->pixmap(screenNumber());
+    if (m_transparent->source() != root)
+        m_transparent->setSource(root, screenNumber());
+
+    if (m_buffer_pm) {
+        if (m_transparent->dest() != m_buffer_pm) {
+            m_transparent->setDest(m_buffer_pm, screenNumber());
+        }
+    } else if (m_transparent->dest() != window())
+        m_transparent->setDest(window(), screenNumber());
 }
 
 void FbWindow::setAlpha(unsigned char alpha) {
-#ifdef HAVE_XRENDER
     if (m_transparent.get() == 0 && alpha != 0) {
-        m_transparent.reset(new Transparent(getRootPixmap(screenNumber()), window(), alpha, screenNumber()));
+        m_transparent.reset(new Transparent(RootPixmap::instance()->pixmap(screenNumber()), window(), alpha, screenNumber()));
     } else if (alpha != 0 && alpha != m_transparent->alpha())
         m_transparent->setAlpha(alpha);
     else if (alpha == 0)
         m_transparent.reset(0); // destroy transparent object
-#endif // HAVE_XRENDER
 }
 
 
@@ -282,8 +302,10 @@ void FbWindow::setNew(Window win) {
     if (s_display == 0)
         s_display = App::instance()->display();
 
-    if (m_window != 0 && m_destroy)
+    if (m_window != 0 && m_destroy) {
+        FbTk::EventManager::instance()->removeParentWindow(m_window);
         XDestroyWindow(s_display, m_window);
+    }
 
     m_window = win;
 
@@ -349,6 +371,7 @@ void FbWindow::unsetCursor() {
 
 void FbWindow::reparent(const FbWindow &parent, int x, int y) {
     XReparentWindow(s_display, window(), parent.window(), x, y);
+    FbTk::EventManager::instance()->setParentWindow(window(), parent.window());
     m_parent = &parent;
     updateGeometry();
 }
@@ -403,6 +426,8 @@ unsigned char FbWindow::alpha() const {
 }
 void FbWindow::setBufferPixmap(Pixmap pm) {
     m_buffer_pm = pm;
+    if (m_transparent.get())
+        updateTransparentTarget();
 }
 
 void FbWindow::updateGeometry() {
@@ -447,6 +472,8 @@ void FbWindow::create(Window parent, int x, int y,
     
     assert(m_window);
 
+    FbTk::EventManager::instance()->setParentWindow(m_window, parent);
+
     updateGeometry();
     FbWindow::setBackgroundColor(Color("gray", screenNumber()));
 }
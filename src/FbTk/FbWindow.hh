@@ -80,9 +80,20 @@ public:
     virtual void clearArea(int x, int y, 
                            unsigned int width, unsigned int height, 
                            bool exposures = false);
+    /// clear a set of areas and update their transparency in one go
+    void clearArea(XRectangle *rects, int num_rects);
     void updateTransparent(int x = -1, int y = -1, unsigned int width = 0, unsigned int height = 0);
+    /// update transparency clipped to a set of areas
+    void updateTransparent(XRectangle *rects, int num_rects);
 
     void setAlpha(unsigned char alpha);
+    /**
+       Render transparency into pm instead of the window.
+       While a buffer is set clear() and clearArea() only clear, the
+       owner of the buffer calls updateTransparent() to fill it.
+       0 renders to the window again.
+    */
+    void setBufferPixmap(Pixmap pm);
 
     virtual FbWindow &operator = (const FbWindow &win);
     /// assign a new X window to this
@@ -185,9 +196,10 @@ public:
 protected:
     /// creates a window with x window client (m_window = client)
     explicit FbWindow(Window client);
-    void setBufferPixmap(Pixmap pm);
 
 private:
+    /// sets source and destination of the transparent object
+    void updateTransparentTarget();
     /// sets new X window and destroys old
     void setNew(Window win);
     /// creates a new X window
@@ -78,6 +78,11 @@ public:
         XSetClipOrigin(m_display, m_gc, x, y);
     }
 
+    inline void setClipRectangles(XRectangle *rects, int num_rects,
+                                  int ordering = Unsorted) {
+        XSetClipRectangles(m_display, m_gc, 0, 0, rects, num_rects, ordering);
+    }
+
     inline void setGraphicsExposure(bool value) {
         XSetGraphicsExposures(m_display, m_gc, value);
     }
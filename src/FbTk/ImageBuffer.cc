@@ -0,0 +1,279 @@
+// ImageBuffer.cc for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include "ImageBuffer.hh"
+#include "App.hh"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <X11/Xutil.h>
+
+#ifdef HAVE_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif // HAVE_XSHM
+
+#include <cstdlib>
+#include <iostream>
+using namespace std;
+
+namespace {
+
+#ifdef HAVE_XSHM
+bool s_attach_failed = false;
+
+int handleAttachError(Display *, XErrorEvent *) {
+    s_attach_failed = true;
+    return 0;
+}
+#endif // HAVE_XSHM
+
+} // end anonymous namespace
+
+namespace FbTk {
+
+/// the shared memory segment
+class ImageBuffer_priv {
+public:
+#ifdef HAVE_XSHM
+    ImageBuffer_priv():size(0) {
+        info.shmseg = 0;
+        info.shmid = -1;
+        info.shmaddr = 0;
+        info.readOnly = False;
+    }
+
+    ~ImageBuffer_priv() {
+        // the server detaches by itself when the connection closes
+        // and the segment is already marked for removal
+        if (info.shmaddr != 0)
+            shmdt(info.shmaddr);
+    }
+
+    void detach() {
+        if (info.shmaddr == 0)
+            return;
+        XShmDetach(FbTk::App::instance()->display(), &info);
+        shmdt(info.shmaddr);
+        info.shmaddr = 0;
+        info.shmid = -1;
+        size = 0;
+    }
+
+    /// @return false if the server couldn't attach, i.e remote display
+    bool attach(size_t new_size) {
+        detach();
+
+        info.shmid = shmget(IPC_PRIVATE, new_size, IPC_CREAT | 0600);
+        if (info.shmid < 0)
+            return false;
+
+        info.shmaddr = static_cast<char *>(shmat(info.shmid, 0, 0));
+        if (info.shmaddr == reinterpret_cast<char *>(-1)) {
+            info.shmaddr = 0;
+            shmctl(info.shmid, IPC_RMID, 0);
+            return false;
+        }
+
+        Display *disp = FbTk::App::instance()->display();
+        s_attach_failed = false;
+        XErrorHandler old_handler = XSetErrorHandler(handleAttachError);
+        XShmAttach(disp, &info);
+        XSync(disp, False);
+        XSetErrorHandler(old_handler);
+        // the segment is freed when both we and the server detach
+        shmctl(info.shmid, IPC_RMID, 0);
+
+        if (s_attach_failed) {
+            shmdt(info.shmaddr);
+            info.shmaddr = 0;
+            return false;
+        }
+
+        size = new_size;
+        return true;
+    }
+
+    XShmSegmentInfo info;
+    size_t size;
+#endif // HAVE_XSHM
+};
+
+bool ImageBuffer::s_init = false;
+bool ImageBuffer::s_shm = false;
+
+ImageBuffer::ImageBuffer():
+    m_data(new ImageBuffer_priv()),
+    m_image(0),
+    m_shared(false),
+    m_pending(false) {
+
+}
+
+ImageBuffer::~ImageBuffer() {
+    freeImage();
+}
+
+bool ImageBuffer::haveShm() {
+    if (!s_init) {
+#ifdef HAVE_XSHM
+        s_shm = XShmQueryExtension(FbTk::App::instance()->display());
+#endif // HAVE_XSHM
+        s_init = true;
+    }
+    return s_shm;
+}
+
+XImage *ImageBuffer::get(Drawable drawable, int depth,
+                         int x, int y, unsigned int width, unsigned int height) {
+    freeImage();
+    if (drawable == 0 || width == 0 || height == 0)
+        return 0;
+
+    Display *disp = FbTk::App::instance()->display();
+
+#ifdef HAVE_XSHM
+    if (createShared(depth, width, height) != 0) {
+        if (XShmGetImage(disp, drawable, m_image, x, y, AllPlanes))
+            return m_image;
+        freeImage();
+    }
+#endif // HAVE_XSHM
+
+    m_image = XGetImage(disp, drawable,
+                        x, y, width, height,
+                        AllPlanes, ZPixmap);
+    return m_image;
+}
+
+XImage *ImageBuffer::create(int depth, unsigned int width, unsigned int height) {
+    freeImage();
+    if (width == 0 || height == 0)
+        return 0;
+
+#ifdef HAVE_XSHM
+    if (createShared(depth, width, height) != 0)
+        return m_image;
+#endif // HAVE_XSHM
+
+    Display *disp = FbTk::App::instance()->display();
+    m_image = XCreateImage(disp, DefaultVisual(disp, DefaultScreen(disp)),
+                           depth, ZPixmap, 0, 0,
+                           width, height,
+                           32, 0);
+    if (m_image == 0)
+        return 0;
+
+    m_image->data = static_cast<char *>(malloc(m_image->bytes_per_line * height));
+    if (m_image->data == 0) {
+        XDestroyImage(m_image);
+        m_image = 0;
+    }
+
+    return m_image;
+}
+
+void ImageBuffer::put(Drawable drawable, GC gc, int dest_x, int dest_y) {
+    if (m_image == 0 || drawable == 0 || gc == 0)
+        return;
+
+    Display *disp = FbTk::App::instance()->display();
+
+#ifdef HAVE_XSHM
+    if (m_shared) {
+        XShmPutImage(disp, drawable, gc, m_image,
+                     0, 0, dest_x, dest_y,
+                     m_image->width, m_image->height,
+                     False); // no completion event, see sync()
+        m_pending = true;
+        return;
+    }
+#endif // HAVE_XSHM
+
+    XPutImage(disp, drawable, gc, m_image,
+              0, 0, dest_x, dest_y,
+              m_image->width, m_image->height);
+}
+
+void ImageBuffer::release() {
+    sync();
+    freeImage();
+#ifdef HAVE_XSHM
+    m_data->detach();
+#endif // HAVE_XSHM
+}
+
+XImage *ImageBuffer::createShared(int depth, unsigned int width, unsigned int height) {
+#ifdef HAVE_XSHM
+    if (!haveShm())
+        return 0;
+
+    Display *disp = FbTk::App::instance()->display();
+
+    XImage *image = XShmCreateImage(disp, DefaultVisual(disp, DefaultScreen(disp)),
+                                    depth, ZPixmap, 0, &m_data->info,
+                                    width, height);
+    if (image == 0)
+        return 0;
+
+    size_t size = image->bytes_per_line * height;
+    // wait until the server is done with the old content
+    sync();
+    if (size > m_data->size && !m_data->attach(size)) {
+        cerr<<"Warning! FbTk::ImageBuffer: Failed to attach shared memory, "
+            <<"using XGetImage/XPutImage."<<endl;
+        s_shm = false;
+        XDestroyImage(image);
+        return 0;
+    }
+
+    image->data = m_data->info.shmaddr;
+    m_image = image;
+    m_shared = true;
+    return m_image;
+#else
+    return 0;
+#endif // HAVE_XSHM
+}
+
+void ImageBuffer::freeImage() {
+    if (m_image == 0)
+        return;
+
+    // the shared segment is kept for the next image
+    if (m_shared)
+        m_image->data = 0;
+    XDestroyImage(m_image);
+    m_image = 0;
+    m_shared = false;
+}
+
+void ImageBuffer::sync() {
+    if (!m_pending)
+        return;
+    XSync(FbTk::App::instance()->display(), False);
+    m_pending = false;
+}
+
+} // end namespace FbTk
@@ -0,0 +1,89 @@
+// ImageBuffer.hh for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FBTK_IMAGEBUFFER_HH
+#define FBTK_IMAGEBUFFER_HH
+
+#include "NotCopyable.hh"
+
+#include <X11/Xlib.h>
+
+#include <memory>
+
+namespace FbTk {
+
+class ImageBuffer_priv;
+
+/**
+   Client side image that moves pixels to and from drawables.
+   If the display supports MIT-SHM and is local the pixels are
+   transferred through a shared memory segment, the segment is
+   kept and reused by the following transfers. Otherwise plain
+   XGetImage/XPutImage is used.
+
+   The image returned by get() and create() is owned by the buffer
+   and valid until the next call.
+*/
+class ImageBuffer: private NotCopyable {
+public:
+    ImageBuffer();
+    ~ImageBuffer();
+
+    /**
+       reads an area of drawable, depth must be the drawable's depth
+       @return 0 on failure
+    */
+    XImage *get(Drawable drawable, int depth,
+                int x, int y, unsigned int width, unsigned int height);
+    /**
+       creates an image with undefined content for put()
+       @return 0 on failure
+    */
+    XImage *create(int depth, unsigned int width, unsigned int height);
+    /// sends the current image to drawable
+    void put(Drawable drawable, GC gc, int dest_x, int dest_y);
+    /// frees the image and the shared segment, for buffers used once
+    void release();
+
+    /// @return true if the current image uses shared memory
+    bool shared() const { return m_shared; }
+    /// @return true if the display supports MIT-SHM
+    static bool haveShm();
+
+private:
+    /// creates image in the shared segment, grows the segment if needed
+    XImage *createShared(int depth, unsigned int width, unsigned int height);
+    void freeImage();
+    /// waits for the server to finish with the shared segment
+    void sync();
+
+    std::auto_ptr<ImageBuffer_priv> m_data;
+    XImage *m_image;
+    bool m_shared; ///< wheter m_image is in the shared segment
+    bool m_pending; ///< the server might still read the segment
+
+    static bool s_init;
+    static bool s_shm; ///< MIT-SHM works on this display
+};
+
+} // end namespace FbTk
+
+#endif // FBTK_IMAGEBUFFER_HH
@@ -0,0 +1,528 @@
+// ImageScaler.cc for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+
+#include "ImageScaler.hh"
+#include "PixelUtil.hh"
+
+#include <X11/Xutil.h>
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// the kernels are compiled for SSE2 and AVX2 and picked at runtime
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define FBTK_SCALER_X86 1
+#include <immintrin.h>
+#define FBTK_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace {
+
+using FbTk::PixelUtil::Channel;
+using FbTk::PixelUtil::nativeByteOrder;
+
+/// weights are fixed point with this many fraction bits
+const int WEIGHT_BITS = 14;
+const int WEIGHT_ONE = 1 << WEIGHT_BITS;
+
+inline unsigned char clampChannel(int value) {
+    value = (value + (WEIGHT_ONE >> 1)) >> WEIGHT_BITS;
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/// @return two weights packed for pmaddwd
+inline int weightPair(short first, short second) {
+    return (static_cast<unsigned short>(second) << 16) | static_cast<unsigned short>(first);
+}
+
+/// weighted sum of count pixels
+unsigned int horizontalScalar(const unsigned int *src, unsigned int count,
+                              const short *weights) {
+    int sum[4] = { 0, 0, 0, 0 };
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(src);
+    for (unsigned int k = 0; k < count; ++k, bytes += 4) {
+        for (int c = 0; c < 4; ++c)
+            sum[c] += bytes[c] * weights[k];
+    }
+
+    unsigned int pixel;
+    unsigned char *out = reinterpret_cast<unsigned char *>(&pixel);
+    for (int c = 0; c < 4; ++c)
+        out[c] = clampChannel(sum[c]);
+    return pixel;
+}
+
+/// weighted sum of count rows for width pixels
+void verticalScalar(const unsigned int *rows, unsigned int stride,
+                    unsigned int count, const short *weights,
+                    unsigned int *dest, unsigned int width) {
+    for (unsigned int x = 0; x < width; ++x) {
+        int sum[4] = { 0, 0, 0, 0 };
+        for (unsigned int k = 0; k < count; ++k) {
+            const unsigned char *bytes =
+                reinterpret_cast<const unsigned char *>(rows + k * stride + x);
+            for (int c = 0; c < 4; ++c)
+                sum[c] += bytes[c] * weights[k];
+        }
+        unsigned char *out = reinterpret_cast<unsigned char *>(dest + x);
+        for (int c = 0; c < 4; ++c)
+            out[c] = clampChannel(sum[c]);
+    }
+}
+
+#ifdef FBTK_SCALER_X86
+
+/// rounds four 32 bit sums and packs them to four bytes
+FBTK_TARGET("sse2")
+inline unsigned int packSums(__m128i sum) {
+    sum = _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(WEIGHT_ONE >> 1)), WEIGHT_BITS);
+    sum = _mm_packs_epi32(sum, sum);
+    return _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+}
+
+/// adds the weighted pixels from k on to sum, two at a time
+FBTK_TARGET("sse2")
+inline __m128i horizontalSum(__m128i sum, const unsigned int *src,
+                             unsigned int k, unsigned int count,
+                             const short *weights) {
+    const __m128i zero = _mm_setzero_si128();
+    for (; k + 2 <= count; k += 2) {
+        // channels of both pixels next to each other
+        __m128i pixels = _mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + k)), zero);
+        pixels = _mm_unpacklo_epi16(pixels, _mm_srli_si128(pixels, 8));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(pixels,
+                                                _mm_set1_epi32(weightPair(weights[k],
+                                                                          weights[k + 1]))));
+    }
+    if (k < count) {
+        __m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128(src[k]), zero);
+        pixel = _mm_unpacklo_epi16(pixel, zero);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(pixel,
+                                                _mm_set1_epi32(weightPair(weights[k], 0))));
+    }
+    return sum;
+}
+
+FBTK_TARGET("sse2")
+unsigned int horizontalSSE2(const unsigned int *src, unsigned int count,
+                            const short *weights) {
+    return packSums(horizontalSum(_mm_setzero_si128(), src, 0, count, weights));
+}
+
+FBTK_TARGET("avx2")
+unsigned int horizontalAVX2(const unsigned int *src, unsigned int count,
+                            const short *weights) {
+    // channels of pixel pairs next to each other within each lane
+    const __m256i interleave = _mm256_setr_epi8(0, 1, 8, 9, 2, 3, 10, 11,
+                                                4, 5, 12, 13, 6, 7, 14, 15,
+                                                0, 1, 8, 9, 2, 3, 10, 11,
+                                                4, 5, 12, 13, 6, 7, 14, 15);
+    __m256i sum = _mm256_setzero_si256();
+    unsigned int k = 0;
+    for (; k + 4 <= count; k += 4) {
+        __m256i pixels = _mm256_cvtepu8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + k)));
+        pixels = _mm256_shuffle_epi8(pixels, interleave);
+        const int low = weightPair(weights[k], weights[k + 1]);
+        const int high = weightPair(weights[k + 2], weights[k + 3]);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pixels,
+                                                      _mm256_setr_epi32(low, low, low, low,
+                                                                        high, high, high, high)));
+    }
+    __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                   _mm256_extracti128_si256(sum, 1));
+    return packSums(horizontalSum(sum128, src, k, count, weights));
+}
+
+/// four pixels of count rows
+FBTK_TARGET("sse2")
+inline void verticalBlock(const unsigned int *rows, unsigned int stride,
+                          unsigned int count, const short *weights,
+                          unsigned int *dest) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum0 = zero, sum1 = zero, sum2 = zero, sum3 = zero;
+    for (unsigned int k = 0; k < count; k += 2) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows + k * stride));
+        __m128i b = zero;
+        short second = 0;
+        if (k + 1 < count) {
+            b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows + (k + 1) * stride));
+            second = weights[k + 1];
+        }
+        const __m128i weight = _mm_set1_epi32(weightPair(weights[k], second));
+        __m128i a_lo = _mm_unpacklo_epi8(a, zero), a_hi = _mm_unpackhi_epi8(a, zero);
+        __m128i b_lo = _mm_unpacklo_epi8(b, zero), b_hi = _mm_unpackhi_epi8(b, zero);
+        sum0 = _mm_add_epi32(sum0, _mm_madd_epi16(_mm_unpacklo_epi16(a_lo, b_lo), weight));
+        sum1 = _mm_add_epi32(sum1, _mm_madd_epi16(_mm_unpackhi_epi16(a_lo, b_lo), weight));
+        sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_unpacklo_epi16(a_hi, b_hi), weight));
+        sum3 = _mm_add_epi32(sum3, _mm_madd_epi16(_mm_unpackhi_epi16(a_hi, b_hi), weight));
+    }
+
+    const __m128i round = _mm_set1_epi32(WEIGHT_ONE >> 1);
+    sum0 = _mm_srai_epi32(_mm_add_epi32(sum0, round), WEIGHT_BITS);
+    sum1 = _mm_srai_epi32(_mm_add_epi32(sum1, round), WEIGHT_BITS);
+    sum2 = _mm_srai_epi32(_mm_add_epi32(sum2, round), WEIGHT_BITS);
+    sum3 = _mm_srai_epi32(_mm_add_epi32(sum3, round), WEIGHT_BITS);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest),
+                     _mm_packus_epi16(_mm_packs_epi32(sum0, sum1),
+                                      _mm_packs_epi32(sum2, sum3)));
+}
+
+FBTK_TARGET("sse2")
+void verticalSSE2(const unsigned int *rows, unsigned int stride,
+                  unsigned int count, const short *weights,
+                  unsigned int *dest, unsigned int width) {
+    unsigned int x = 0;
+    for (; x + 4 <= width; x += 4)
+        verticalBlock(rows + x, stride, count, weights, dest + x);
+    verticalScalar(rows + x, stride, count, weights, dest + x, width - x);
+}
+
+FBTK_TARGET("avx2")
+void verticalAVX2(const unsigned int *rows, unsigned int stride,
+                  unsigned int count, const short *weights,
+                  unsigned int *dest, unsigned int width) {
+    // unpack and pack work within 128 bit lanes so the order is kept
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32(WEIGHT_ONE >> 1);
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i sum0 = zero, sum1 = zero, sum2 = zero, sum3 = zero;
+        for (unsigned int k = 0; k < count; k += 2) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows + k * stride + x));
+            __m256i b = zero;
+            short second = 0;
+            if (k + 1 < count) {
+                b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows + (k + 1) * stride + x));
+                second = weights[k + 1];
+            }
+            const __m256i weight = _mm256_set1_epi32(weightPair(weights[k], second));
+            __m256i a_lo = _mm256_unpacklo_epi8(a, zero), a_hi = _mm256_unpackhi_epi8(a, zero);
+            __m256i b_lo = _mm256_unpacklo_epi8(b, zero), b_hi = _mm256_unpackhi_epi8(b, zero);
+            sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(_mm256_unpacklo_epi16(a_lo, b_lo), weight));
+            sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(_mm256_unpackhi_epi16(a_lo, b_lo), weight));
+            sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_unpacklo_epi16(a_hi, b_hi), weight));
+            sum3 = _mm256_add_epi32(sum3, _mm256_madd_epi16(_mm256_unpackhi_epi16(a_hi, b_hi), weight));
+        }
+        sum0 = _mm256_srai_epi32(_mm256_add_epi32(sum0, round), WEIGHT_BITS);
+        sum1 = _mm256_srai_epi32(_mm256_add_epi32(sum1, round), WEIGHT_BITS);
+        sum2 = _mm256_srai_epi32(_mm256_add_epi32(sum2, round), WEIGHT_BITS);
+        sum3 = _mm256_srai_epi32(_mm256_add_epi32(sum3, round), WEIGHT_BITS);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + x),
+                            _mm256_packus_epi16(_mm256_packs_epi32(sum0, sum1),
+                                                _mm256_packs_epi32(sum2, sum3)));
+    }
+    for (; x + 4 <= width; x += 4)
+        verticalBlock(rows + x, stride, count, weights, dest + x);
+    verticalScalar(rows + x, stride, count, weights, dest + x, width - x);
+}
+
+#endif // FBTK_SCALER_X86
+
+typedef unsigned int (*HorizontalKernel)(const unsigned int *src, unsigned int count,
+                                         const short *weights);
+typedef void (*VerticalKernel)(const unsigned int *rows, unsigned int stride,
+                               unsigned int count, const short *weights,
+                               unsigned int *dest, unsigned int width);
+
+/// the fastest kernels this cpu can run
+struct Kernels {
+    Kernels():horizontal(horizontalScalar), vertical(verticalScalar) {
+#ifdef FBTK_SCALER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            horizontal = horizontalAVX2;
+            vertical = verticalAVX2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            horizontal = horizontalSSE2;
+            vertical = verticalSSE2;
+        }
+#endif // FBTK_SCALER_X86
+    }
+    HorizontalKernel horizontal;
+    VerticalKernel vertical;
+};
+
+const Kernels &kernels() {
+    static Kernels s_kernels;
+    return s_kernels;
+}
+
+/// filter radius in source pixels when not shrinking
+double filterRadius(FbTk::ImageScaler::Filter filter) {
+    switch (filter) {
+    case FbTk::ImageScaler::BOX:
+        return 0.5;
+    case FbTk::ImageScaler::BILINEAR:
+        return 1.0;
+    case FbTk::ImageScaler::LANCZOS2:
+        return 2.0;
+    }
+    return 0.5;
+}
+
+double filterWeight(FbTk::ImageScaler::Filter filter, double x) {
+    switch (filter) {
+    case FbTk::ImageScaler::BOX:
+        // half open, so neighbours don't share a pixel
+        return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+    case FbTk::ImageScaler::BILINEAR:
+        x = std::fabs(x);
+        return x < 1.0 ? 1.0 - x : 0.0;
+    case FbTk::ImageScaler::LANCZOS2:
+        if (x == 0.0)
+            return 1.0;
+        if (x <= -2.0 || x >= 2.0)
+            return 0.0;
+        x *= M_PI;
+        return 2.0 * std::sin(x) * std::sin(x / 2.0) / (x * x);
+    }
+    return 0.0;
+}
+
+/**
+   Converts pixels of a visual with up to 8 bits per channel
+   to three 8 bit channels and back
+*/
+class PixelFormat {
+public:
+    explicit PixelFormat(const XImage &image) {
+        Channel channels[3] = {
+            Channel(image.red_mask), Channel(image.green_mask), Channel(image.blue_mask)
+        };
+        m_valid = true;
+        for (int c = 0; c < 3; ++c) {
+            m_channels[c] = channels[c];
+            if (channels[c].max == 0 || channels[c].max > 0xFF)
+                m_valid = false;
+        }
+        m_native16 = (image.bits_per_pixel == 16 &&
+                      image.byte_order == nativeByteOrder());
+    }
+
+    bool valid() const { return m_valid; }
+
+    void unpack(const XImage &image, int y, unsigned int *row) const {
+        XImage &img = const_cast<XImage &>(image);
+        const unsigned short *row16 = reinterpret_cast<const unsigned short *>(
+            image.data + y * image.bytes_per_line);
+        for (int x = 0; x < image.width; ++x) {
+            unsigned long pixel = m_native16 ? row16[x] : XGetPixel(&img, x, y);
+            unsigned char *out = reinterpret_cast<unsigned char *>(row + x);
+            for (int c = 0; c < 3; ++c) {
+                unsigned long value = (pixel >> m_channels[c].shift) & m_channels[c].max;
+                out[c] = (value * 255 + m_channels[c].max / 2) / m_channels[c].max;
+            }
+            out[3] = 0xFF;
+        }
+    }
+
+    void pack(XImage &image, int y, const unsigned int *row) const {
+        unsigned short *row16 = reinterpret_cast<unsigned short *>(
+            image.data + y * image.bytes_per_line);
+        for (int x = 0; x < image.width; ++x) {
+            const unsigned char *in = reinterpret_cast<const unsigned char *>(row + x);
+            unsigned long pixel = 0;
+            for (int c = 0; c < 3; ++c)
+                pixel |= ((in[c] * m_channels[c].max + 127) / 255) << m_channels[c].shift;
+            if (m_native16)
+                row16[x] = pixel;
+            else
+                XPutPixel(&image, x, y, pixel);
+        }
+    }
+
+private:
+    Channel m_channels[3];
+    bool m_valid;
+    bool m_native16;
+};
+
+/// @return true if all color channels are whole bytes, or there are no masks
+bool byteChannels(const XImage &image) {
+    const unsigned long masks[3] = { image.red_mask, image.green_mask, image.blue_mask };
+    for (int c = 0; c < 3; ++c) {
+        Channel channel(masks[c]);
+        if (masks[c] != 0 && (channel.max != 0xFF || channel.shift % 8 != 0))
+            return false;
+    }
+    return true;
+}
+
+} // end anonymous namespace
+
+namespace FbTk {
+
+ImageScaler::ImageScaler(Filter filter):m_filter(filter) { }
+
+void ImageScaler::setFilter(Filter filter) {
+    if (filter == m_filter)
+        return;
+    m_filter = filter;
+    // weights have to be computed again
+    m_x_table = Table();
+    m_y_table = Table();
+}
+
+void ImageScaler::scale(const unsigned int *src,
+                        unsigned int src_width, unsigned int src_height,
+                        unsigned int src_stride,
+                        unsigned int *dest,
+                        unsigned int dest_width, unsigned int dest_height,
+                        unsigned int dest_stride) {
+    if (src_width == 0 || src_height == 0 || dest_width == 0 || dest_height == 0)
+        return;
+
+    updateTable(m_x_table, src_width, dest_width);
+    updateTable(m_y_table, src_height, dest_height);
+    m_rows.resize(dest_width * src_height);
+
+    for (unsigned int y = 0; y < src_height; ++y)
+        scaleRow(src + y * src_stride, y);
+    for (unsigned int y = 0; y < dest_height; ++y)
+        scaleColumns(y, dest + y * dest_stride);
+}
+
+bool ImageScaler::scale(const XImage &src, XImage &dest) {
+    if (src.format != ZPixmap || dest.format != ZPixmap ||
+        src.bits_per_pixel != dest.bits_per_pixel ||
+        src.width <= 0 || src.height <= 0 || dest.width <= 0 || dest.height <= 0)
+        return false;
+
+    if (src.bits_per_pixel == 32 && byteChannels(dest)) {
+        // the byte order doesn't matter, each byte is scaled alone
+        scale(reinterpret_cast<const unsigned int *>(src.data),
+              src.width, src.height, src.bytes_per_line / 4,
+              reinterpret_cast<unsigned int *>(dest.data),
+              dest.width, dest.height, dest.bytes_per_line / 4);
+        return true;
+    }
+
+    if (src.bits_per_pixel < 15)
+        return false;
+
+    PixelFormat format(dest);
+    if (!format.valid())
+        return false;
+
+    updateTable(m_x_table, src.width, dest.width);
+    updateTable(m_y_table, src.height, dest.height);
+    m_rows.resize(dest.width * src.height);
+    m_src_row.resize(src.width);
+    m_dest_row.resize(dest.width);
+
+    for (int y = 0; y < src.height; ++y) {
+        format.unpack(src, y, &m_src_row[0]);
+        scaleRow(&m_src_row[0], y);
+    }
+    for (int y = 0; y < dest.height; ++y) {
+        scaleColumns(y, &m_dest_row[0]);
+        format.pack(dest, y, &m_dest_row[0]);
+    }
+    return true;
+}
+
+void ImageScaler::updateTable(Table &table,
+                              unsigned int src_size, unsigned int dest_size) {
+    if (table.src_size == src_size && table.dest_size == dest_size)
+        return;
+
+    table.src_size = src_size;
+    table.dest_size = dest_size;
+    table.spans.resize(dest_size);
+    table.weights.clear();
+
+    const double scale = static_cast<double>(src_size) / dest_size;
+    // when shrinking the filter covers more source pixels
+    const double filter_scale = std::max(scale, 1.0);
+    const double support = filterRadius(m_filter) * filter_scale;
+
+    std::vector<double> weights;
+    for (unsigned int i = 0; i < dest_size; ++i) {
+        const double center = (i + 0.5) * scale;
+        int start = std::max(0, static_cast<int>(std::floor(center - support)));
+        int end = std::min(static_cast<int>(src_size),
+                           static_cast<int>(std::ceil(center + support)));
+
+        weights.clear();
+        double total = 0.0;
+        for (int j = start; j < end; ++j) {
+            double weight = filterWeight(m_filter, (j + 0.5 - center) / filter_scale);
+            weights.push_back(weight);
+            total += weight;
+        }
+
+        // drop zero weights at the ends
+        size_t first = 0, last = weights.size();
+        while (first < last && weights[first] == 0.0)
+            ++first;
+        while (last > first && weights[last - 1] == 0.0)
+            --last;
+
+        Span &span = table.spans[i];
+        span.weights = table.weights.size();
+        if (first == last || total == 0.0) {
+            // nothing covered, take the nearest pixel
+            span.start = std::min(static_cast<unsigned int>(center), src_size - 1);
+            span.count = 1;
+            table.weights.push_back(WEIGHT_ONE);
+            continue;
+        }
+
+        span.start = start + first;
+        span.count = last - first;
+        // normalize, the rounding error goes to the largest weight
+        int sum = 0;
+        size_t largest = span.weights;
+        for (size_t k = first; k < last; ++k) {
+            short weight = static_cast<short>(std::floor(weights[k] / total * WEIGHT_ONE + 0.5));
+            if (table.weights.size() == span.weights || weight > table.weights[largest])
+                largest = table.weights.size();
+            table.weights.push_back(weight);
+            sum += weight;
+        }
+        table.weights[largest] += WEIGHT_ONE - sum;
+    }
+}
+
+void ImageScaler::scaleRow(const unsigned int *src, unsigned int src_row) {
+    HorizontalKernel kernel = kernels().horizontal;
+    unsigned int *out = &m_rows[src_row * m_x_table.dest_size];
+    const short *weights = &m_x_table.weights[0];
+    for (unsigned int x = 0; x < m_x_table.dest_size; ++x) {
+        const Span &span = m_x_table.spans[x];
+        out[x] = kernel(src + span.start, span.count, weights + span.weights);
+    }
+}
+
+void ImageScaler::scaleColumns(unsigned int dest_row, unsigned int *dest) {
+    const Span &span = m_y_table.spans[dest_row];
+    const unsigned int stride = m_x_table.dest_size;
+    kernels().vertical(&m_rows[span.start * stride], stride,
+                       span.count, &m_y_table.weights[span.weights],
+                       dest, stride);
+}
+
+} // end namespace FbTk
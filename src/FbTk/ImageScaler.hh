@@ -0,0 +1,103 @@
+// ImageScaler.hh for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+
+#ifndef FBTK_IMAGESCALER_HH
+#define FBTK_IMAGESCALER_HH
+
+#include "NotCopyable.hh"
+
+#include <X11/Xlib.h>
+
+#include <vector>
+
+namespace FbTk {
+
+/**
+   Resamples client side images with a box, bilinear or Lanczos-2 filter.
+   The filter is applied in two passes, first the rows then the columns.
+   Pixels are scaled as four 8 bit channels, 16 and 24 bit visuals are
+   expanded to that and packed again. The kernels use SSE2 or AVX2 when
+   the cpu has them, this is checked at runtime.
+   Weight tables are kept, so scaling between the same sizes again
+   doesn't compute them again.
+*/
+class ImageScaler: private NotCopyable {
+public:
+    enum Filter {
+        BOX, ///< average of the covered pixels, best for shrinking
+        BILINEAR, ///< linear interpolation
+        LANCZOS2 ///< sharper, windowed sinc with two lobes
+    };
+
+    explicit ImageScaler(Filter filter = BOX);
+
+    void setFilter(Filter filter);
+    Filter filter() const { return m_filter; }
+
+    /**
+       Scales pixels with four 8 bit channels, like ARGB32.
+       The channels are scaled independently, so alpha should be
+       premultiplied. Strides are in pixels.
+    */
+    void scale(const unsigned int *src,
+               unsigned int src_width, unsigned int src_height,
+               unsigned int src_stride,
+               unsigned int *dest,
+               unsigned int dest_width, unsigned int dest_height,
+               unsigned int dest_stride);
+    /**
+       Scales src to the size of dest. Both must be ZPixmap images with
+       the same bits per pixel, the color masks of dest are used for both.
+       @return false if the format isn't supported, like bitmaps
+    */
+    bool scale(const XImage &src, XImage &dest);
+
+private:
+    /// source pixels and weights for one destination pixel
+    struct Span {
+        unsigned int start; ///< first source pixel
+        unsigned int count; ///< number of source pixels
+        unsigned int weights; ///< index of first weight
+    };
+    /// weights to scale one axis from src_size to dest_size
+    struct Table {
+        Table():src_size(0), dest_size(0) { }
+        unsigned int src_size, dest_size;
+        std::vector<Span> spans;
+        std::vector<short> weights; ///< fixed point, each span sums to 1 << 14
+    };
+
+    void updateTable(Table &table, unsigned int src_size, unsigned int dest_size);
+    /// scales row src_row of the source into row src_row of m_rows
+    void scaleRow(const unsigned int *src, unsigned int src_row);
+    /// scales the columns of m_rows into destination row dest_row
+    void scaleColumns(unsigned int dest_row, unsigned int *dest);
+
+    Filter m_filter;
+    Table m_x_table, m_y_table;
+    std::vector<unsigned int> m_rows; ///< rows scaled in width only
+    std::vector<unsigned int> m_src_row, m_dest_row; ///< unpacked pixels
+};
+
+} // end namespace FbTk
+
+#endif // FBTK_IMAGESCALER_HH
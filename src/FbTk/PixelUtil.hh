@@ -0,0 +1,63 @@
+// PixelUtil.hh for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FBTK_PIXELUTIL_HH
+#define FBTK_PIXELUTIL_HH
+
+#include <X11/Xlib.h>
+
+namespace FbTk {
+
+/// helpers for pixels in client side images
+namespace PixelUtil {
+
+/// position and size of a color channel in a pixel
+struct Channel {
+    explicit Channel(unsigned long mask = 0):shift(0), max(0) {
+        if (mask == 0)
+            return;
+        while ((mask & 1) == 0) {
+            mask >>= 1;
+            ++shift;
+        }
+        max = mask;
+    }
+    unsigned int shift;
+    unsigned long max; ///< mask shifted down
+};
+
+/// @return byte order of this machine, LSBFirst or MSBFirst
+inline int nativeByteOrder() {
+    const unsigned short value = 1;
+    return *reinterpret_cast<const unsigned char *>(&value) == 1 ? LSBFirst : MSBFirst;
+}
+
+/// divides x (at most 255 * 255) by 255 with rounding
+inline unsigned int div255(unsigned int x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+} // end namespace PixelUtil
+
+} // end namespace FbTk
+
+#endif // FBTK_PIXELUTIL_HH
@@ -0,0 +1,170 @@
+// RedrawScheduler.cc for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include "RedrawScheduler.hh"
+
+#include "FbWindow.hh"
+
+#include <algorithm>
+
+namespace {
+
+/// max number of rectangles per window before they're merged
+const size_t MAX_RECTANGLES = 16;
+
+/// @return true if a covers b
+inline bool contains(const XRectangle &a, const XRectangle &b) {
+    return a.x <= b.x && a.y <= b.y &&
+        a.x + a.width >= b.x + b.width &&
+        a.y + a.height >= b.y + b.height;
+}
+
+} // end anonymous namespace
+
+namespace FbTk {
+
+RedrawScheduler *RedrawScheduler::instance() {
+    static RedrawScheduler scheduler;
+    return &scheduler;
+}
+
+RedrawScheduler::RedrawScheduler():
+    m_flush_cmd(*this, &RedrawScheduler::flush),
+    m_timer(m_flush_cmd),
+    m_last_flush(0),
+    m_interval(0) {
+
+}
+
+void RedrawScheduler::markDirty(FbWindow &win) {
+    markDirty(win, 0, 0, win.width(), win.height());
+}
+
+void RedrawScheduler::markDirty(FbWindow &win, int x, int y,
+                                unsigned int width, unsigned int height) {
+    if (win.window() == 0)
+        return;
+
+    // clip to window
+    int x2 = std::min(x + static_cast<int>(width), static_cast<int>(win.width()));
+    int y2 = std::min(y + static_cast<int>(height), static_cast<int>(win.height()));
+    x = std::max(x, 0);
+    y = std::max(y, 0);
+    if (x2 <= x || y2 <= y)
+        return;
+
+    XRectangle area;
+    area.x = x;
+    area.y = y;
+    area.width = x2 - x;
+    area.height = y2 - y;
+
+    Rectangles &rects = m_dirty[&win];
+    // drop rectangles covered by the new one and
+    // skip the new one if it's already covered
+    Rectangles::iterator it = rects.begin();
+    while (it != rects.end()) {
+        if (contains(*it, area)) {
+            schedule();
+            return;
+        }
+        if (contains(area, *it))
+            it = rects.erase(it);
+        else
+            ++it;
+    }
+
+    rects.push_back(area);
+
+    // too many pieces, use the bounding box instead
+    if (rects.size() > MAX_RECTANGLES) {
+        XRectangle box = rects[0];
+        for (size_t i = 1; i < rects.size(); ++i) {
+            int box_x2 = std::max(box.x + box.width, rects[i].x + rects[i].width);
+            int box_y2 = std::max(box.y + box.height, rects[i].y + rects[i].height);
+            box.x = std::min(box.x, rects[i].x);
+            box.y = std::min(box.y, rects[i].y);
+            box.width = box_x2 - box.x;
+            box.height = box_y2 - box.y;
+        }
+        rects.assign(1, box);
+    }
+
+    schedule();
+}
+
+void RedrawScheduler::remove(FbWindow &win) {
+    m_dirty.erase(&win);
+}
+
+void RedrawScheduler::flush() {
+    m_timer.stop();
+    m_last_flush = Timer::now();
+
+    // redrawing might mark other windows dirty,
+    // they will be handled in the next frame
+    DirtyMap dirty;
+    dirty.swap(m_dirty);
+
+    DirtyMap::iterator it = dirty.begin();
+    DirtyMap::iterator it_end = dirty.end();
+    for (; it != it_end; ++it)
+        redraw(*it->first, it->second);
+}
+
+void RedrawScheduler::flush(FbWindow &win) {
+    DirtyMap::iterator it = m_dirty.find(&win);
+    if (it == m_dirty.end())
+        return;
+
+    Rectangles rects;
+    rects.swap(it->second);
+    m_dirty.erase(it);
+    redraw(win, rects);
+}
+
+void RedrawScheduler::redraw(FbWindow &win, Rectangles &rects) {
+    if (rects.empty())
+        return;
+
+    if (rects.size() == 1 &&
+        rects[0].x == 0 && rects[0].y == 0 &&
+        rects[0].width >= win.width() && rects[0].height >= win.height())
+        win.clear();
+    else
+        win.clearArea(&rects[0], rects.size());
+}
+
+void RedrawScheduler::setMaxFps(int fps) {
+    m_interval = fps > 0 ? 1000 / fps : 0;
+}
+
+void RedrawScheduler::schedule() {
+    if (m_timer.isTiming())
+        return;
+
+    // wait for the rest of the frame interval, if any
+    Timer::Time elapsed = Timer::now() - m_last_flush;
+    m_timer.setTimeout(elapsed >= m_interval ? 0 : m_interval - elapsed);
+    m_timer.start();
+}
+
+} // end namespace FbTk
@@ -0,0 +1,84 @@
+// RedrawScheduler.hh for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FBTK_REDRAWSCHEDULER_HH
+#define FBTK_REDRAWSCHEDULER_HH
+
+#include "NotCopyable.hh"
+#include "Timer.hh"
+#include "SimpleCommand.hh"
+
+#include <X11/Xlib.h>
+#include <map>
+#include <vector>
+
+namespace FbTk {
+
+class FbWindow;
+
+/// singleton that collects dirty areas and redraws them once per frame
+/**
+ * Instead of clearing a window right away, mark it dirty: \n
+ * RedrawScheduler::instance()->markDirty(window); \n
+ * All dirty areas of a window are merged into a small set of
+ * rectangles and the window is redrawn at most once per frame
+ * interval, with one transparency composite clipped to the dirty
+ * rectangles.
+ * @see setMaxFps
+ */
+class RedrawScheduler: private NotCopyable {
+public:
+    static RedrawScheduler *instance();
+
+    /// mark the whole window as dirty
+    void markDirty(FbWindow &win);
+    /// mark an area of the window as dirty
+    void markDirty(FbWindow &win, int x, int y,
+                   unsigned int width, unsigned int height);
+    /// forget any pending redraw of win
+    void remove(FbWindow &win);
+    /// redraw all dirty windows now
+    void flush();
+    /// redraw win now if it's dirty
+    void flush(FbWindow &win);
+    /// limit redraws to fps frames per second, 0 means no limit
+    void setMaxFps(int fps);
+
+private:
+    RedrawScheduler();
+    /// start the timer unless it's already running
+    void schedule();
+
+    typedef std::vector<XRectangle> Rectangles;
+    static void redraw(FbWindow &win, Rectangles &rects);
+
+    typedef std::map<FbWindow *, Rectangles> DirtyMap;
+    DirtyMap m_dirty; ///< dirty area of each window
+
+    SimpleCommand<RedrawScheduler> m_flush_cmd;
+    Timer m_timer;
+    Timer::Time m_last_flush;
+    unsigned int m_interval; ///< frame interval in milliseconds
+};
+
+} // end namespace FbTk
+
+#endif // FBTK_REDRAWSCHEDULER_HH
@@ -0,0 +1,93 @@
+// RootPixmap.cc for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include "RootPixmap.hh"
+#include "App.hh"
+
+#include <X11/Xatom.h>
+
+namespace FbTk {
+
+RootPixmap *RootPixmap::instance() {
+    static RootPixmap root_pixmap;
+    return &root_pixmap;
+}
+
+RootPixmap::RootPixmap() {
+    Display *disp = FbTk::App::instance()->display();
+    m_xrootpmap_id = XInternAtom(disp, "_XROOTPMAP_ID", False);
+    m_esetroot_pmap_id = XInternAtom(disp, "ESETROOT_PMAP_ID", False);
+}
+
+Pixmap RootPixmap::pixmap(int screen_num) {
+    PixmapMap::iterator it = m_pixmaps.find(screen_num);
+    if (it != m_pixmaps.end())
+        return it->second;
+
+    Pixmap pm = fetch(screen_num);
+    m_pixmaps[screen_num] = pm;
+    return pm;
+}
+
+bool RootPixmap::propertyNotify(const XPropertyEvent &event) {
+    if (event.atom != m_xrootpmap_id && event.atom != m_esetroot_pmap_id)
+        return false;
+
+    Display *disp = FbTk::App::instance()->display();
+    for (int screen_num = 0; screen_num < ScreenCount(disp); ++screen_num) {
+        if (RootWindow(disp, screen_num) == event.window) {
+            // refetch, the other property might still be valid
+            m_pixmaps[screen_num] = fetch(screen_num);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+Pixmap RootPixmap::fetch(int screen_num) const {
+    Display *disp = FbTk::App::instance()->display();
+    Atom props[] = { m_xrootpmap_id, m_esetroot_pmap_id };
+
+    for (size_t i = 0; i < sizeof(props)/sizeof(*props); ++i) {
+        Atom real_type;
+        int real_format;
+        unsigned long items_read, items_left;
+        unsigned char *data = 0;
+        if (XGetWindowProperty(disp, RootWindow(disp, screen_num),
+                               props[i],
+                               0L, 1L,
+                               False, XA_PIXMAP, &real_type,
+                               &real_format, &items_read, &items_left,
+                               &data) == Success && data != 0) {
+            Pixmap root_pm = 0;
+            if (items_read != 0 && real_format == 32)
+                root_pm = *reinterpret_cast<Pixmap *>(data);
+            XFree(data);
+            if (root_pm != 0)
+                return root_pm;
+        }
+    }
+
+    return 0;
+}
+
+} // end namespace FbTk
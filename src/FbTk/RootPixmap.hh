@@ -0,0 +1,60 @@
+// RootPixmap.hh for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FBTK_ROOTPIXMAP_HH
+#define FBTK_ROOTPIXMAP_HH
+
+#include "NotCopyable.hh"
+
+#include <X11/Xlib.h>
+#include <map>
+
+namespace FbTk {
+
+/// singleton that remembers the wallpaper pixmap of each screen
+/**
+ * The pixmap is read from _XROOTPMAP_ID (or ESETROOT_PMAP_ID) the
+ * first time it's needed and then only when the property changes.
+ * Pass root window PropertyNotify events to propertyNotify(), the
+ * root window needs PropertyChangeMask.
+ */
+class RootPixmap: private NotCopyable {
+public:
+    static RootPixmap *instance();
+
+    /// @return wallpaper pixmap of screen, 0 if none is set
+    Pixmap pixmap(int screen_num);
+    /// @return true if event changed the wallpaper pixmap property
+    bool propertyNotify(const XPropertyEvent &event);
+
+private:
+    RootPixmap();
+    /// read the wallpaper properties of screen
+    Pixmap fetch(int screen_num) const;
+
+    typedef std::map<int, Pixmap> PixmapMap;
+    PixmapMap m_pixmaps; ///< pixmap of each screen
+    Atom m_xrootpmap_id, m_esetroot_pmap_id;
+};
+
+} // end namespace FbTk
+
+#endif // FBTK_ROOTPIXMAP_HH
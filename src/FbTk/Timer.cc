@@ -0,0 +1,137 @@
+// Timer.cc for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include "Timer.hh"
+
+#include "Command.hh"
+
+#include <time.h>
+#include <sys/time.h>
+
+namespace FbTk {
+
+Timer::TimerList Timer::s_timerlist;
+
+Timer::Timer():m_command(0), m_timing(false), m_once(true),
+               m_timeout(0), m_expire(0) {
+
+}
+
+Timer::Timer(Command &cmd):m_command(&cmd), m_timing(false), m_once(true),
+                           m_timeout(0), m_expire(0) {
+
+}
+
+Timer::~Timer() {
+    if (isTiming())
+        stop();
+}
+
+void Timer::setTimeout(unsigned int msec) {
+    m_timeout = msec;
+}
+
+void Timer::setCommand(Command &cmd) {
+    m_command = &cmd;
+}
+
+void Timer::start() {
+    // restart if we're already running
+    if (isTiming())
+        removeTimer(this);
+
+    m_expire = now() + m_timeout;
+    m_timing = true;
+    addTimer(this);
+}
+
+void Timer::stop() {
+    if (!isTiming())
+        return;
+    m_timing = false;
+    removeTimer(this);
+}
+
+void Timer::updateTimers() {
+    if (s_timerlist.empty())
+        return;
+
+    const Time current = now();
+    // commands may start and stop timers, so pick them
+    // from the front of the list one at the time
+    while (!s_timerlist.empty() &&
+           s_timerlist.front()->m_expire <= current) {
+        Timer *timer = s_timerlist.front();
+        s_timerlist.pop_front();
+
+        if (timer->doOnce())
+            timer->m_timing = false;
+        else {
+            // at least 1 ms, or a zero timeout would expire again in this loop
+            timer->m_expire = current +
+                (timer->m_timeout > 0 ? timer->m_timeout : 1);
+            addTimer(timer);
+        }
+
+        if (timer->m_command != 0)
+            timer->m_command->execute();
+    }
+}
+
+int Timer::nextTimeout() {
+    if (s_timerlist.empty())
+        return -1;
+
+    const Time current = now();
+    const Time expire = s_timerlist.front()->m_expire;
+    if (expire <= current)
+        return 0;
+
+    return static_cast<int>(expire - current);
+}
+
+Timer::Time Timer::now() {
+    timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        return static_cast<Time>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+
+    // no monotonic clock, better than nothing
+    timeval tv;
+    gettimeofday(&tv, 0);
+    return static_cast<Time>(tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+}
+
+void Timer::addTimer(Timer *timer) {
+    // keep the list sorted so the next timer is always first
+    TimerList::iterator it = s_timerlist.begin();
+    TimerList::iterator it_end = s_timerlist.end();
+    for (; it != it_end; ++it) {
+        if ((*it)->m_expire > timer->m_expire)
+            break;
+    }
+    s_timerlist.insert(it, timer);
+}
+
+void Timer::removeTimer(Timer *timer) {
+    s_timerlist.remove(timer);
+}
+
+} // end namespace FbTk
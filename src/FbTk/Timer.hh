@@ -0,0 +1,91 @@
+// Timer.hh for FbTk - fluxbox toolkit
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FBTK_TIMER_HH
+#define FBTK_TIMER_HH
+
+#include "NotCopyable.hh"
+
+#include <list>
+
+namespace FbTk {
+
+class Command;
+
+/// Calls a command after a timeout
+/**
+ * Timers are driven by App::eventLoop and use a monotonic clock,
+ * so changing the system time does not affect them. \n
+ * Example: \n
+ * Timer timer(cmd); \n
+ * timer.setTimeout(100); // msec \n
+ * timer.start(); \n
+ * The command is not owned by the timer.
+ */
+class Timer: private NotCopyable {
+public:
+    /// time in milliseconds
+    typedef unsigned long long Time;
+
+    Timer();
+    explicit Timer(Command &cmd);
+    ~Timer();
+
+    /// fire only once (default) or repeat until stopped
+    inline void fireOnce(bool once) { m_once = once; }
+    /// set timeout in milliseconds
+    void setTimeout(unsigned int msec);
+    void setCommand(Command &cmd);
+    /// starts (or restarts) the timer
+    void start();
+    void stop();
+
+    inline bool isTiming() const { return m_timing; }
+    inline bool doOnce() const { return m_once; }
+    inline unsigned int timeout() const { return m_timeout; }
+
+    /// fires all timers that have timed out
+    static void updateTimers();
+    /**
+       @return milliseconds until the next timer expires,
+       0 if one is due and -1 if no timer is running
+    */
+    static int nextTimeout();
+    /// @return current time of the monotonic clock
+    static Time now();
+
+private:
+    static void addTimer(Timer *timer);
+    static void removeTimer(Timer *timer);
+
+    typedef std::list<Timer *> TimerList;
+    static TimerList s_timerlist; ///< running timers, sorted by expire time
+
+    Command *m_command;
+    bool m_timing; ///< wheter the timer is running
+    bool m_once; ///< wheter to fire only once
+    unsigned int m_timeout; ///< timeout in milliseconds
+    Time m_expire; ///< when the timer fires next
+};
+
+} // end namespace FbTk
+
+#endif // FBTK_TIMER_HH
@@ -23,6 +23,9 @@
 
 #include "Transparent.hh"
 #include "App.hh"
+#include "AlphaBlend.hh"
+#include "ImageBuffer.hh"
+#include "GContext.hh"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -33,62 +36,160 @@
 #endif // HAVE_XRENDER
 
 #include <iostream>
+#include <algorithm>
+#include <map>
 using namespace std;
 
 namespace {
+
+/// wallpaper pixels for software blending
+FbTk::ImageBuffer &sourceBuffer() {
+    static FbTk::ImageBuffer buffer;
+    return buffer;
+}
+
+/// pixels of the destination for software blending
+FbTk::ImageBuffer &destBuffer() {
+    static FbTk::ImageBuffer buffer;
+    return buffer;
+}
+
+/**
+   @return weight of the source (0-255) for alpha, the same
+   weight the RENDER alpha mask gives
+*/
+unsigned char softwareAlpha(unsigned char alpha) {
+    unsigned short mask = ((unsigned short) (255 * alpha) << 8);
+    if (alpha == 0)
+        mask = 0xFF00;
+    return mask >> 8;
+}
+
 #ifdef HAVE_XRENDER
-Picture createAlphaPic(Window drawable, unsigned char alpha) {
-    Display *disp = FbTk::App::instance()->display();
 
-    // try to find a specific render format
-    XRenderPictFormat pic_format;
-    pic_format.type  = PictTypeDirect;
-    pic_format.depth = 8; // alpha with bit depth 8
-    pic_format.direct.alphaMask = 0xff;    
-    XRenderPictFormat *format = XRenderFindFormat(disp, PictFormatType |
-                                                  PictFormatDepth | PictFormatAlphaMask,
-                                                  &pic_format, 0);
-    if (format == 0) {
-        cerr<<"Warning! FbTk::Transparent:  Failed to find valid format for alpha."<<endl;
-        return 0;
+/// alpha pictures and formats shared by all Transparent objects
+class PictureCache {
+public:
+    PictureCache():m_alpha_format(0), m_alpha_format_init(false) { }
+
+    /// @return format for pictures on the default visual of screen
+    XRenderPictFormat *visualFormat(int screen_num) {
+        FormatMap::iterator it = m_formats.find(screen_num);
+        if (it != m_formats.end())
+            return it->second;
+
+        Display *disp = FbTk::App::instance()->display();
+        XRenderPictFormat *format =
+            XRenderFindVisualFormat(disp, DefaultVisual(disp, screen_num));
+        if (format == 0)
+            cerr<<"Warning! FbTk::Transparent: Failed to find format for screen("<<screen_num<<")"<<endl;
+        m_formats[screen_num] = format;
+        return format;
     }
 
-    // create one pixel pixmap with depth 8 for alpha
-    Pixmap alpha_pm = XCreatePixmap(disp, drawable,
-                                    1, 1, 8);
-    if (alpha_pm == 0) {
-        cerr<<"Warning! FbTk::Transparent: Failed to create alpha pixmap."<<endl;
-        return 0;
+    /// @return shared alpha picture, release it with releaseAlpha
+    Picture acquireAlpha(int screen_num, unsigned char alpha) {
+        AlphaKey key(screen_num, alpha);
+        AlphaMap::iterator it = m_alpha_pics.find(key);
+        if (it != m_alpha_pics.end()) {
+            ++it->second.refs;
+            return it->second.pic;
+        }
+
+        Picture pic = createAlphaPic(screen_num, alpha);
+        if (pic != 0)
+            m_alpha_pics[key] = AlphaPic(pic);
+        return pic;
     }
 
-    // create picture with alpha_pm as repeated background
-    XRenderPictureAttributes attr;
-    attr.repeat = True; // small bitmap repeated
-    Picture alpha_pic = XRenderCreatePicture(disp, alpha_pm,
-                                             format, CPRepeat, &attr);
-    if (alpha_pic == 0) {
-        XFreePixmap(disp, alpha_pm);
-        cerr<<"Warning! FbTk::Transparent: Failed to create alpha picture."<<endl;
-        return 0;
+    void releaseAlpha(int screen_num, unsigned char alpha) {
+        AlphaMap::iterator it = m_alpha_pics.find(AlphaKey(screen_num, alpha));
+        if (it == m_alpha_pics.end() || --it->second.refs > 0)
+            return;
+
+        XRenderFreePicture(FbTk::App::instance()->display(), it->second.pic);
+        m_alpha_pics.erase(it);
     }
 
-    // finaly set alpha and fill with it
-    XRenderColor color;
-    // calculate alpha percent and then scale it to short
-    color.red = 0xFF;
-    color.blue = 0xFF;
-    color.green = 0xFF;
-    color.alpha = ((unsigned short) (255 * alpha) << 8);
-    if (alpha == 0)
-        color.alpha = 0xFF00;
+private:
+    Picture createAlphaPic(int screen_num, unsigned char alpha) {
+        Display *disp = FbTk::App::instance()->display();
+
+        if (!m_alpha_format_init) {
+            // try to find a specific render format
+            XRenderPictFormat pic_format;
+            pic_format.type  = PictTypeDirect;
+            pic_format.depth = 8; // alpha with bit depth 8
+            pic_format.direct.alphaMask = 0xff;
+            m_alpha_format = XRenderFindFormat(disp, PictFormatType |
+                                               PictFormatDepth | PictFormatAlphaMask,
+                                               &pic_format, 0);
+            m_alpha_format_init = true;
+        }
+
+        if (m_alpha_format == 0) {
+            cerr<<"Warning! FbTk::Transparent:  Failed to find valid format for alpha."<<endl;
+            return 0;
+        }
+
+        // create one pixel pixmap with depth 8 for alpha
+        Pixmap alpha_pm = XCreatePixmap(disp, RootWindow(disp, screen_num),
+                                        1, 1, 8);
+        if (alpha_pm == 0) {
+            cerr<<"Warning! FbTk::Transparent: Failed to create alpha pixmap."<<endl;
+            return 0;
+        }
+
+        // create picture with alpha_pm as repeated background
+        XRenderPictureAttributes attr;
+        attr.repeat = True; // small bitmap repeated
+        Picture alpha_pic = XRenderCreatePicture(disp, alpha_pm,
+                                                 m_alpha_format, CPRepeat, &attr);
+        if (alpha_pic == 0) {
+            XFreePixmap(disp, alpha_pm);
+            cerr<<"Warning! FbTk::Transparent: Failed to create alpha picture."<<endl;
+            return 0;
+        }
+
+        // finaly set alpha and fill with it
+        XRenderColor color;
+        // calculate alpha percent and then scale it to short
+        color.red = 0xFF;
+        color.blue = 0xFF;
+        color.green = 0xFF;
+        color.alpha = ((unsigned short) (255 * alpha) << 8);
+        if (alpha == 0)
+            color.alpha = 0xFF00;
+
+        XRenderFillRectangle(disp, PictOpSrc, alpha_pic, &color,
+                             0, 0, 1, 1);
+
+        XFreePixmap(disp, alpha_pm);
 
-    XRenderFillRectangle(disp, PictOpSrc, alpha_pic, &color,
-                         0, 0, 1, 1);
+        return alpha_pic;
+    }
 
-    XFreePixmap(disp, alpha_pm);
+    struct AlphaPic {
+        AlphaPic():pic(0), refs(0) { }
+        explicit AlphaPic(Picture p):pic(p), refs(1) { }
+        Picture pic;
+        int refs; ///< number of Transparent objects using pic
+    };
+    typedef std::pair<int, unsigned char> AlphaKey; ///< screen and alpha
+    typedef std::map<AlphaKey, AlphaPic> AlphaMap;
+    typedef std::map<int, XRenderPictFormat *> FormatMap;
+
+    AlphaMap m_alpha_pics;
+    FormatMap m_formats;
+    XRenderPictFormat *m_alpha_format;
+    bool m_alpha_format_init;
+};
 
-    return alpha_pic;
+PictureCache &pictureCache() {
+    static PictureCache cache;
+    return cache;
 }
+
 #endif //  HAVE_XRENDER
 };
 
@@ -99,35 +200,21 @@ bool Transparent::s_render = false;
 
 Transparent::Transparent(Drawable src, Drawable dest, unsigned char alpha, int screen_num):
     m_alpha_pic(0), m_src_pic(0), m_dest_pic(0),
-    m_source(src), m_dest(dest), m_alpha(alpha) {
+    m_source(src), m_dest(dest), m_alpha(alpha), m_screen_num(screen_num),
+    m_source_width(0), m_source_height(0), m_source_depth(0) {
 
-    Display *disp = FbTk::App::instance()->display();
-
-    // check for RENDER support
-    if (!s_init) {
-        int major_opcode, first_event, first_error;
-        if (XQueryExtension(disp, "RENDER", 
-                            &major_opcode, 
-                            &first_event, &first_error) == False) {
-            s_render = false;
-        } else { // we got RENDER support
-            s_render = true;
-        }
-        s_init = true;
+    if (!haveRender()) {
+        updateSourceGeometry();
+        return;
     }
 
-    
 #ifdef HAVE_XRENDER
-    if (!s_render)
-        return;
-
-    allocAlpha(m_alpha);
 
+    Display *disp = FbTk::App::instance()->display();
 
-    XRenderPictFormat *format = 
-        XRenderFindVisualFormat(disp, 
-                                DefaultVisual(disp, screen_num));
+    allocAlpha(m_alpha);
 
+    XRenderPictFormat *format = pictureCache().visualFormat(screen_num);
 
     if (src != 0 && format != 0) {
         m_src_pic = XRenderCreatePicture(disp, src, format, 
@@ -141,6 +228,24 @@ Transparent::Transparent(Drawable src, Drawable dest, unsigned char alpha, int s
 #endif // HAVE_XRENDER
 }
 
+bool Transparent::haveRender() {
+    // check for RENDER support
+    if (!s_init) {
+#ifdef HAVE_XRENDER
+        int major_opcode, first_event, first_error;
+        if (XQueryExtension(FbTk::App::instance()->display(), "RENDER",
+                            &major_opcode,
+                            &first_event, &first_error) == False) {
+            s_render = false;
+        } else { // we got RENDER support
+            s_render = true;
+        }
+#endif // HAVE_XRENDER
+        s_init = true;
+    }
+    return s_render;
+}
+
 Transparent::~Transparent() {
 #ifdef HAVE_XRENDER
     if (m_alpha_pic != 0 && s_render)
@@ -157,17 +262,27 @@ Transparent::~Transparent() {
 }
 
 void Transparent::setAlpha(unsigned char alpha) {
-    if (m_source == 0 || !s_render)
+    if (!s_render) {
+        m_alpha = alpha;
+        return;
+    }
+
+    if (alpha == m_alpha && m_alpha_pic != 0)
         return;
 
-    freeAlpha();
     allocAlpha(alpha);
 }
 
 void Transparent::setDest(Drawable dest, int screen_num) {
-#ifdef HAVE_XRENDER
-    if (m_dest == dest || !s_render)
+    if (m_dest == dest)
+        return;
+
+    if (!s_render) {
+        m_dest = dest;
         return;
+    }
+
+#ifdef HAVE_XRENDER
 
     Display *disp = FbTk::App::instance()->display();
 
@@ -178,28 +293,26 @@ void Transparent::setDest(Drawable dest, int screen_num) {
     // create new dest pic if we have a valid dest drawable
     if (dest != 0) {
 
-        XRenderPictFormat *format = 
-            XRenderFindVisualFormat(disp, 
-                                    DefaultVisual(disp, screen_num));
-        if (format == 0)
-            cerr<<"Warning! FbTk::Transparent: Failed to find format for screen("<<screen_num<<")"<<endl;
-        m_dest_pic = XRenderCreatePicture(disp, dest, format, 0, 0);
-       
-
+        XRenderPictFormat *format = pictureCache().visualFormat(screen_num);
+        if (format != 0)
+            m_dest_pic = XRenderCreatePicture(disp, dest, format, 0, 0);
     }
     m_dest = dest;
 #endif // HAVE_XRENDER
 }
 
 void Transparent::setSource(Drawable source, int screen_num) {
-#ifdef HAVE_XRENDER
-    if (m_source == source || !s_render)
+    if (m_source == source)
         return;
-    // save old alpha value so we can recreate new later
-    // with the same value
-    unsigned char old_alpha = m_alpha;
-    if (m_alpha_pic != 0)
-        freeAlpha();
+
+    if (!s_render) {
+        m_source = source;
+        m_screen_num = screen_num;
+        updateSourceGeometry();
+        return;
+    }
+
+#ifdef HAVE_XRENDER
 
     Display *disp = FbTk::App::instance()->display();   
 
@@ -213,17 +326,19 @@ void Transparent::setSource(Drawable source, int screen_num) {
     // create new source pic if we have a valid source drawable
     if (m_source != 0) {
 
-        XRenderPictFormat *format = 
-            XRenderFindVisualFormat(disp, 
-                                    DefaultVisual(disp, screen_num));
-        if (format == 0)
-            cerr<<"Warning! FbTk::Transparent: Failed to find format for screen("<<screen_num<<")"<<endl;
-        m_src_pic = XRenderCreatePicture(disp, m_source, format, 
-                                         0, 0);    
+        XRenderPictFormat *format = pictureCache().visualFormat(screen_num);
+        if (format != 0)
+            m_src_pic = XRenderCreatePicture(disp, m_source, format,
+                                             0, 0);
     }
 
-    // recreate new alpha
-    allocAlpha(old_alpha);
+    // the alpha picture belongs to the screen, not to the source
+    if (screen_num != m_screen_num) {
+        unsigned char old_alpha = m_alpha;
+        freeAlpha();
+        m_screen_num = screen_num;
+        allocAlpha(old_alpha);
+    }
 
 #endif // HAVE_XRENDER
 }
@@ -231,6 +346,25 @@ void Transparent::setSource(Drawable source, int screen_num) {
 void Transparent::render(int src_x, int src_y,
                          int dest_x, int dest_y,
                          unsigned int width, unsigned int height) const {
+    if (!s_render) {
+        if (m_clip.empty()) {
+            renderSoftware(src_x, src_y, dest_x, dest_y, width, height);
+            return;
+        }
+        // blend each clip rectangle on its own
+        for (size_t i = 0; i < m_clip.size(); ++i) {
+            const XRectangle &clip = m_clip[i];
+            int x1 = std::max(dest_x, static_cast<int>(clip.x));
+            int y1 = std::max(dest_y, static_cast<int>(clip.y));
+            int x2 = std::min(dest_x + static_cast<int>(width), clip.x + static_cast<int>(clip.width));
+            int y2 = std::min(dest_y + static_cast<int>(height), clip.y + static_cast<int>(clip.height));
+            if (x2 > x1 && y2 > y1)
+                renderSoftware(src_x + x1 - dest_x, src_y + y1 - dest_y,
+                               x1, y1, x2 - x1, y2 - y1);
+        }
+        return;
+    }
+
 #ifdef HAVE_XRENDER
     if (m_src_pic == 0 || m_dest_pic == 0 ||
         m_alpha_pic  == 0 || !s_render)
@@ -249,14 +383,38 @@ void Transparent::render(int src_x, int src_y,
 #endif // HAVE_XRENDER
 }
 
+void Transparent::setClipRectangles(XRectangle *rects, int num_rects) {
+    if (!s_render) {
+        m_clip.clear();
+        if (num_rects > 0 && rects != 0)
+            m_clip.assign(rects, rects + num_rects);
+        return;
+    }
+
+#ifdef HAVE_XRENDER
+    if (m_dest_pic == 0)
+        return;
+
+    Display *disp = FbTk::App::instance()->display();
+    if (num_rects > 0 && rects != 0) {
+        XRenderSetPictureClipRectangles(disp, m_dest_pic, 0, 0,
+                                        rects, num_rects);
+    } else {
+        XRenderPictureAttributes attr;
+        attr.clip_mask = None;
+        XRenderChangePicture(disp, m_dest_pic, CPClipMask, &attr);
+    }
+#endif // HAVE_XRENDER
+}
+
 void Transparent::allocAlpha(unsigned char alpha) {
 #ifdef HAVE_XRENDER
-    if (m_source == 0 || !s_render)
+    if (!s_render)
         return;
     if (m_alpha_pic != 0)
         freeAlpha();
 
-    m_alpha_pic = createAlphaPic(m_source, alpha);
+    m_alpha_pic = pictureCache().acquireAlpha(m_screen_num, alpha);
     m_alpha = alpha;
 #endif // HAVE_XRENDER
 }
@@ -264,12 +422,79 @@ void Transparent::allocAlpha(unsigned char alpha) {
 void Transparent::freeAlpha() {
 #ifdef HAVE_XRENDER
     if (s_render && m_alpha_pic != 0)
-        XRenderFreePicture(FbTk::App::instance()->display(), m_alpha_pic);
+        pictureCache().releaseAlpha(m_screen_num, m_alpha);
 #endif // HAVE_XRENDER
     m_alpha_pic = 0;
     m_alpha = 255;
 }
 
+void Transparent::updateSourceGeometry() {
+    m_source_width = m_source_height = 0;
+    m_source_depth = 0;
+    if (m_source == 0)
+        return;
+
+    Display *disp = FbTk::App::instance()->display();
+    Window root;
+    int x, y;
+    unsigned int border_width, depth;
+    if (XGetGeometry(disp, m_source, &root, &x, &y,
+                     &m_source_width, &m_source_height,
+                     &border_width, &depth) == 0)
+        return;
+
+    // we blend with images of the screens visual
+    if (static_cast<int>(depth) == DefaultDepth(disp, m_screen_num))
+        m_source_depth = depth;
+}
+
+void Transparent::renderSoftware(int src_x, int src_y,
+                                 int dest_x, int dest_y,
+                                 unsigned int width, unsigned int height) const {
+    if (m_source == 0 || m_dest == 0 || m_source_depth == 0)
+        return;
+
+    Display *disp = FbTk::App::instance()->display();
+
+    // the source is in root coordinates, so limit the area to the
+    // source pixmap and to the screen where windows can be read
+    int x1 = std::max(std::max(src_x, 0), src_x - dest_x);
+    int y1 = std::max(std::max(src_y, 0), src_y - dest_y);
+    int x2 = std::min(src_x + static_cast<int>(width),
+                      std::min(static_cast<int>(m_source_width),
+                               DisplayWidth(disp, m_screen_num)));
+    int y2 = std::min(src_y + static_cast<int>(height),
+                      std::min(static_cast<int>(m_source_height),
+                               DisplayHeight(disp, m_screen_num)));
+    if (x2 <= x1 || y2 <= y1)
+        return;
+
+    dest_x += x1 - src_x;
+    dest_y += y1 - src_y;
+    width = x2 - x1;
+    height = y2 - y1;
+
+    XImage *src_image = sourceBuffer().get(m_source, m_source_depth,
+                                           x1, y1, width, height);
+    if (src_image == 0)
+        return;
+    XImage *dest_image = destBuffer().get(m_dest, m_source_depth,
+                                          dest_x, dest_y, width, height);
+    if (dest_image == 0)
+        return;
+
+    // plain XGetImage doesn't know the visual of pixmaps
+    Visual *visual = DefaultVisual(disp, m_screen_num);
+    dest_image->red_mask = visual->red_mask;
+    dest_image->green_mask = visual->green_mask;
+    dest_image->blue_mask = visual->blue_mask;
+
+    AlphaBlend::blend(*dest_image, *src_image, softwareAlpha(m_alpha));
+
+    GContext gc(m_dest);
+    destBuffer().put(m_dest, gc.gc(), dest_x, dest_y);
+}
+
 }; // end namespace FbTk
 
 
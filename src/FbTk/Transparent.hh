@@ -26,9 +26,17 @@
 
 #include <X11/Xlib.h>
 
+#include <vector>
+
 namespace FbTk {
 
 /// renders to drawable together with an alpha mask
+/**
+ * Alpha masks and picture formats are shared per screen,
+ * so each Transparent only owns its source and dest pictures.
+ * Without RENDER the source and dest pixels are read back and
+ * blended in software, see AlphaBlend.
+ */
 class Transparent {
 public:
     Transparent(Drawable source, Drawable dest, unsigned char alpha, int screen_num);
@@ -45,19 +53,36 @@ public:
     void render(int src_x, int src_y,
                 int dest_x, int dest_y,
                 unsigned int width, unsigned int height) const;
+    /**
+       limits rendering to rectangles in dest, 
+       num_rects = 0 removes the limit
+    */
+    void setClipRectangles(XRectangle *rects, int num_rects);
 
     unsigned char alpha() const { return m_alpha; }
     Drawable dest() const { return m_dest; }
     Drawable source() const { return m_source; }
 
+    /// @return true if the display supports RENDER and we're built with it
+    static bool haveRender();
+
 private:
     void freeAlpha();
     void allocAlpha(unsigned char newval);
+    /// reads size and depth of the source for software blending
+    void updateSourceGeometry();
+    void renderSoftware(int src_x, int src_y,
+                        int dest_x, int dest_y,
+                        unsigned int width, unsigned int height) const;
     unsigned long m_alpha_pic;
     unsigned long m_src_pic;
     unsigned long m_dest_pic;
     Drawable m_source, m_dest;
     unsigned char m_alpha;
+    int m_screen_num; ///< screen of the alpha picture
+    std::vector<XRectangle> m_clip; ///< clip rectangles for software blending
+    unsigned int m_source_width, m_source_height;
+    int m_source_depth; ///< 0 if the source can't be blended in software
     
     static bool s_init;
     static bool s_render; ///< wheter we have RENDER support
@@ -0,0 +1,188 @@
+// GeometryCache.cc for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include "GeometryCache.hh"
+
+#include "FbTk/App.hh"
+#include "FbTk/FbWindow.hh"
+
+#include "BulkFetch.hh"
+
+#include <X11/Xatom.h>
+
+namespace FbPager {
+
+GeometryCache::GeometryCache(const FbTk::FbWindow &root):
+    m_root(root),
+    m_frame_extents_atom(XInternAtom(FbTk::App::instance()->display(),
+                                     "_NET_FRAME_EXTENTS", False)) {
+
+}
+
+bool GeometryCache::geometry(Window client, Geometry &geom) {
+    EntryMap::iterator it = m_entries.find(client);
+    if (it == m_entries.end()) {
+        Entry entry;
+        if (!fetch(client, entry))
+            return false;
+        it = m_entries.insert(std::make_pair(client, entry)).first;
+    }
+
+    const Entry &entry = it->second;
+    if (entry.have_extents) {
+        geom.x = entry.root_x - entry.left;
+        geom.y = entry.root_y - entry.top;
+        geom.width = entry.width + entry.left + entry.right;
+        geom.height = entry.height + entry.top + entry.bottom;
+    } else {
+        // assume the parent is the frame
+        geom.x = entry.root_x - entry.x;
+        geom.y = entry.root_y - entry.y;
+        geom.width = entry.width;
+        geom.height = entry.height;
+    }
+
+    return true;
+}
+
+void GeometryCache::prefetch(const std::vector<Window> &clients) {
+    BulkFetch fetch;
+    std::vector<Window> fetched;
+    std::vector<BulkFetch::Request> requests;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        if (m_entries.find(clients[i]) != m_entries.end())
+            continue;
+
+        fetched.push_back(clients[i]);
+        requests.push_back(fetch.getGeometry(clients[i]));
+        requests.push_back(fetch.translateCoordinates(clients[i], m_root.window()));
+        requests.push_back(fetch.getProperty(clients[i], m_frame_extents_atom,
+                                             XA_CARDINAL, 4));
+    }
+
+    std::vector<long> extents;
+    for (size_t i = 0; i < fetched.size(); ++i) {
+        Entry entry;
+        unsigned int width, height;
+        if (!fetch.geometry(requests[3*i], entry.x, entry.y, width, height) ||
+            !fetch.coordinates(requests[3*i + 1], entry.root_x, entry.root_y))
+            continue;
+
+        entry.width = width > 0 ? width : 1;
+        entry.height = height > 0 ? height : 1;
+        if (fetch.property(requests[3*i + 2], extents) && extents.size() == 4) {
+            entry.left = extents[0];
+            entry.right = extents[1];
+            entry.top = extents[2];
+            entry.bottom = extents[3];
+            entry.have_extents = true;
+        }
+        m_entries[fetched[i]] = entry;
+    }
+}
+
+void GeometryCache::configureNotify(const XConfigureEvent &event) {
+    EntryMap::iterator it = m_entries.find(event.window);
+    if (it == m_entries.end())
+        return;
+
+    Entry &entry = it->second;
+    if (event.send_event) {
+        // synthetic events from the window manager
+        // carry the root position of the border corner
+        entry.root_x = event.x + event.border_width;
+        entry.root_y = event.y + event.border_width;
+    } else {
+        // position is relative to the parent
+        entry.root_x += event.x - entry.x;
+        entry.root_y += event.y - entry.y;
+        entry.x = event.x;
+        entry.y = event.y;
+    }
+
+    entry.width = event.width > 0 ? event.width : 1;
+    entry.height = event.height > 0 ? event.height : 1;
+}
+
+bool GeometryCache::propertyNotify(const XPropertyEvent &event) {
+    if (event.atom != m_frame_extents_atom)
+        return false;
+
+    EntryMap::iterator it = m_entries.find(event.window);
+    if (it == m_entries.end())
+        return false;
+
+    fetchFrameExtents(event.window, it->second);
+    return true;
+}
+
+void GeometryCache::remove(Window client) {
+    m_entries.erase(client);
+}
+
+bool GeometryCache::fetch(Window client, Entry &entry) const {
+    Display *disp = FbTk::App::instance()->display();
+    Window root, child;
+    unsigned int width, height, border_width, depth;
+    if (XGetGeometry(disp, client, &root,
+                     &entry.x, &entry.y,
+                     &width, &height,
+                     &border_width, &depth) == 0)
+        return false;
+
+    entry.width = width > 0 ? width : 1;
+    entry.height = height > 0 ? height : 1;
+
+    if (XTranslateCoordinates(disp, client, m_root.window(),
+                              0, 0,
+                              &entry.root_x, &entry.root_y,
+                              &child) == 0)
+        return false;
+
+    fetchFrameExtents(client, entry);
+    return true;
+}
+
+void GeometryCache::fetchFrameExtents(Window client, Entry &entry) const {
+    Atom ret_type;
+    int fmt;
+    unsigned long nitems, bytes_after;
+    long *data = 0;
+    entry.have_extents = false;
+    if (XGetWindowProperty(FbTk::App::instance()->display(), client,
+                           m_frame_extents_atom, 0, 4, False, XA_CARDINAL,
+                           &ret_type, &fmt, &nitems, &bytes_after,
+                           (unsigned char **)&data) != Success)
+        return;
+
+    if (data != 0 && nitems == 4) {
+        entry.left = data[0];
+        entry.right = data[1];
+        entry.top = data[2];
+        entry.bottom = data[3];
+        entry.have_extents = true;
+    }
+
+    if (data != 0)
+        XFree(data);
+}
+
+} // end namespace FbPager
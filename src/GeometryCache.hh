@@ -0,0 +1,89 @@
+// GeometryCache.hh for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FBPAGER_GEOMETRYCACHE_HH
+#define FBPAGER_GEOMETRYCACHE_HH
+
+#include "FbTk/NotCopyable.hh"
+
+#include <X11/Xlib.h>
+
+#include <map>
+#include <vector>
+
+namespace FbTk {
+class FbWindow;
+}
+
+namespace FbPager {
+
+/**
+   Keeps the geometry of client windows so the pager doesn't have to
+   ask the server each time a mini window is updated.
+   The cache is fed by ConfigureNotify events and _NET_FRAME_EXTENTS,
+   the server is only asked on a cache miss.
+*/
+class GeometryCache: private FbTk::NotCopyable {
+public:
+    /// geometry of the client's frame in root coordinates
+    struct Geometry {
+        int x, y;
+        unsigned int width, height;
+    };
+
+    explicit GeometryCache(const FbTk::FbWindow &root);
+
+    /// @return geometry of client, false if the window doesn't exist
+    bool geometry(Window client, Geometry &geom);
+    /// ask for the geometry of all clients not in the cache with one round trip
+    void prefetch(const std::vector<Window> &clients);
+    /// update from a ConfigureNotify event, unknown windows are ignored
+    void configureNotify(const XConfigureEvent &event);
+    /// @return true if the property event changed cached geometry
+    bool propertyNotify(const XPropertyEvent &event);
+    void remove(Window client);
+    /// the root window, all geometry is relative to it
+    const FbTk::FbWindow &root() const { return m_root; }
+
+private:
+    struct Entry {
+        Entry():root_x(0), root_y(0), x(0), y(0), width(1), height(1),
+                have_extents(false), left(0), right(0), top(0), bottom(0) { }
+        int root_x, root_y; ///< client's origin on root
+        int x, y; ///< position relative to parent (usually the frame)
+        unsigned int width, height; ///< client size
+        bool have_extents; ///< wheter the window manager set _NET_FRAME_EXTENTS
+        int left, right, top, bottom; ///< frame extents
+    };
+
+    /// ask the server for the geometry of client
+    bool fetch(Window client, Entry &entry) const;
+    void fetchFrameExtents(Window client, Entry &entry) const;
+
+    typedef std::map<Window, Entry> EntryMap;
+    EntryMap m_entries;
+    const FbTk::FbWindow &m_root;
+    Atom m_frame_extents_atom;
+};
+
+} // end namespace FbPager
+
+#endif // FBPAGER_GEOMETRYCACHE_HH
@@ -0,0 +1,394 @@
+// IconCache.cc for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+// $Id$
+
+#include "IconCache.hh"
+
+#include "FbTk/App.hh"
+#include "FbTk/FbPixmap.hh"
+#include "FbTk/GContext.hh"
+#include "FbTk/Transparent.hh"
+#include "FbTk/PixelUtil.hh"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#ifdef HAVE_XRENDER
+#include <X11/extensions/Xrender.h>
+#endif // HAVE_XRENDER
+
+
+namespace {
+
+using FbTk::PixelUtil::div255;
+
+size_t bytesPerPixel(int depth) {
+    if (depth > 16)
+        return 4;
+    else if (depth > 8)
+        return 2;
+    return 1;
+}
+
+/// @return argb with the colors multiplied by alpha, as RENDER wants them
+inline unsigned int premultiply(unsigned int argb) {
+    unsigned int alpha = argb >> 24;
+    if (alpha == 0xFF)
+        return argb;
+    return (alpha << 24) |
+        (div255(((argb >> 16) & 0xFF) * alpha) << 16) |
+        (div255(((argb >> 8) & 0xFF) * alpha) << 8) |
+        div255((argb & 0xFF) * alpha);
+}
+
+} // end anonymous namespace
+
+namespace FbPager {
+
+IconCache::IconCache(size_t budget, size_t disk_budget):
+    m_net_wm_icon(XInternAtom(FbTk::App::instance()->display(),
+                              "_NET_WM_ICON", False)),
+    m_disk(disk_budget),
+    m_budget(budget),
+    m_size(0) {
+
+}
+
+IconCache::~IconCache() {
+    clear();
+}
+
+void IconCache::setBudget(size_t budget) {
+    m_budget = budget;
+    shrink();
+}
+
+Pixmap IconCache::icon(Window client, unsigned int width, unsigned int height,
+                       unsigned long background, int *depth) {
+    if (width == 0 || height == 0)
+        return 0;
+
+    // scaled ARGB icons are kept under the client window
+    EntryMap::iterator it = m_map.find(Key(client, width, height, background));
+    if (it == m_map.end())
+        it = m_map.find(Key(iconPixmap(client), width, height));
+    if (it != m_map.end()) {
+        // move to front of the list
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        if (depth != 0)
+            *depth = it->second->depth;
+        return it->second->pixmap;
+    }
+
+    DiskCache::Mapping mapping;
+    const unsigned int *pixels = netIcon(client, width, height, mapping);
+    if (pixels != 0) {
+        Pixmap pixmap = renderNetIcon(pixels, width, height, background);
+        if (pixmap == 0)
+            return 0;
+        int screen = DefaultScreen(FbTk::App::instance()->display());
+        int pixmap_depth = DefaultDepth(FbTk::App::instance()->display(), screen);
+        if (depth != 0)
+            *depth = pixmap_depth;
+        return insert(Key(client, width, height, background),
+                      pixmap, width, height, pixmap_depth);
+    }
+
+    Key key(iconPixmap(client), width, height);
+    if (key.icon == 0)
+        return 0;
+
+    FbTk::FbPixmap scaled;
+    scaled.copy(key.icon);
+    scaled.scale(width, height);
+    if (scaled.drawable() == 0)
+        return 0;
+
+    int scaled_depth = scaled.depth();
+    if (depth != 0)
+        *depth = scaled_depth;
+    return insert(key, scaled.release(), width, height, scaled_depth);
+}
+
+bool IconCache::propertyNotify(const XPropertyEvent &event) {
+    if (event.atom == m_net_wm_icon) {
+        if (m_net_icons.find(event.window) == m_net_icons.end())
+            return false;
+        // only this client has to read its icon again
+        freeNetIcon(event.window);
+        return true;
+    }
+
+    if (event.atom != XA_WM_HINTS)
+        return false;
+
+    HintMap::iterator it = m_hints.find(event.window);
+    if (it == m_hints.end())
+        return false;
+    // the client might have drawn a new icon into the same pixmap
+    purge(it->second);
+    m_hints.erase(it);
+    return true;
+}
+
+void IconCache::remove(Window client) {
+    m_hints.erase(client);
+    freeNetIcon(client);
+}
+
+void IconCache::clear() {
+    while (!m_entries.empty())
+        erase(m_entries.begin());
+    m_hints.clear();
+    while (!m_net_icons.empty())
+        freeNetIcon(m_net_icons.begin()->first);
+}
+
+Pixmap IconCache::iconPixmap(Window client) {
+    HintMap::iterator it = m_hints.find(client);
+    if (it != m_hints.end())
+        return it->second;
+
+    Pixmap icon = 0;
+    XWMHints *hints = XGetWMHints(FbTk::App::instance()->display(), client);
+    if (hints != 0) {
+        if (hints->flags & IconPixmapHint)
+            icon = hints->icon_pixmap;
+        XFree(hints);
+    }
+
+    m_hints[client] = icon;
+    return icon;
+}
+
+const unsigned int *IconCache::netIcon(Window client,
+                                       unsigned int width, unsigned int height,
+                                       DiskCache::Mapping &mapping) {
+    // ARGB icons are blended with RENDER
+    if (!FbTk::Transparent::haveRender())
+        return 0;
+
+    NetIconMap::iterator it = m_net_icons.find(client);
+    if (it == m_net_icons.end()) {
+        it = m_net_icons.insert(std::make_pair(client, NetIcon())).first;
+        loadNetIcon(client, it->second, width, height);
+    } else if (!it->second.largest &&
+               (it->second.width < width || it->second.height < height)) {
+        // the image we know about is too small for this size
+        loadNetIcon(client, it->second, width, height);
+    }
+
+    const NetIcon &icon = it->second;
+    if (icon.hash == 0)
+        return 0;
+    // someone else might have scaled it already
+    if (m_disk.find(icon.hash, width, height, mapping))
+        return mapping.pixels();
+
+    return scaleNetIcon(icon, width, height);
+}
+
+void IconCache::loadNetIcon(Window client, NetIcon &icon,
+                            unsigned int width, unsigned int height) {
+    Display *disp = FbTk::App::instance()->display();
+    icon = NetIcon();
+
+    Atom type;
+    int format;
+    unsigned long num_items, bytes_after;
+    unsigned char *data = 0;
+    if (XGetWindowProperty(disp, client, m_net_wm_icon,
+                           0, 0x7FFFFFFF, False, XA_CARDINAL,
+                           &type, &format, &num_items, &bytes_after,
+                           &data) != Success || data == 0)
+        return;
+
+    if (type != XA_CARDINAL || format != 32) {
+        XFree(data);
+        return;
+    }
+
+    // the property is a list of width, height and width * height pixels,
+    // only the headers are read until we know which image to use
+    const unsigned long *items = reinterpret_cast<const unsigned long *>(data);
+    const unsigned long *best = 0;
+    const unsigned long *biggest = 0;
+    for (unsigned long pos = 0; pos + 2 <= num_items; ) {
+        const unsigned long *image = items + pos;
+        unsigned long image_width = image[0], image_height = image[1];
+        if (image_width == 0 || image_height == 0 ||
+            image_width > 0xFFFF || image_height > 0xFFFF ||
+            image_width * image_height > num_items - pos - 2)
+            break;
+
+        if (biggest == 0 || image_width * image_height > biggest[0] * biggest[1])
+            biggest = image;
+        // smallest image that covers the size
+        if (image_width >= width && image_height >= height &&
+            (best == 0 || image_width * image_height < best[0] * best[1]))
+            best = image;
+
+        pos += 2 + image_width * image_height;
+    }
+
+    if (best == 0)
+        best = biggest;
+    if (best == 0) {
+        XFree(data);
+        return;
+    }
+
+    const unsigned int source_width = best[0], source_height = best[1];
+    const unsigned long *pixels = best + 2;
+    const size_t num_pixels = source_width * source_height;
+
+    // 32 bit pixels, the property has them in longs
+    icon.pixels.resize(num_pixels);
+    for (size_t i = 0; i < num_pixels; ++i)
+        icon.pixels[i] = pixels[i] & 0xFFFFFFFF;
+    XFree(data);
+
+    // the disk cache is keyed by the image as the client set it
+    unsigned int size[2] = { source_width, source_height };
+    icon.hash = DiskCache::hash(&icon.pixels[0], num_pixels * 4,
+                                DiskCache::hash(size, sizeof(size)));
+    if (icon.hash == 0)
+        icon.hash = 1;
+    icon.width = source_width;
+    icon.height = source_height;
+    icon.largest = (best == biggest);
+
+    for (size_t i = 0; i < num_pixels; ++i)
+        icon.pixels[i] = premultiply(icon.pixels[i]);
+}
+
+const unsigned int *IconCache::scaleNetIcon(const NetIcon &icon,
+                                            unsigned int width, unsigned int height) {
+    if (icon.width == width && icon.height == height)
+        m_scaled = icon.pixels;
+    else {
+        m_scaled.resize(width * height);
+        m_scaler.setFilter(width < icon.width || height < icon.height ?
+                           FbTk::ImageScaler::BOX : FbTk::ImageScaler::BILINEAR);
+        m_scaler.scale(&icon.pixels[0], icon.width, icon.height, icon.width,
+                       &m_scaled[0], width, height, width);
+    }
+
+    m_disk.store(icon.hash, width, height, &m_scaled[0]);
+    return &m_scaled[0];
+}
+
+Pixmap IconCache::renderNetIcon(const unsigned int *pixels,
+                                unsigned int width, unsigned int height,
+                                unsigned long background) {
+#ifdef HAVE_XRENDER
+    Display *disp = FbTk::App::instance()->display();
+    int screen = DefaultScreen(disp);
+
+    XRenderPictFormat *dest_format =
+        XRenderFindVisualFormat(disp, DefaultVisual(disp, screen));
+    XRenderPictFormat *argb_format = XRenderFindStandardFormat(disp, PictStandardARGB32);
+    if (dest_format == 0 || argb_format == 0)
+        return 0;
+
+    // the pixels are sent from where they are, mapped or not
+    XImage *image = XCreateImage(disp, DefaultVisual(disp, screen),
+                                 32, ZPixmap, 0,
+                                 reinterpret_cast<char *>(const_cast<unsigned int *>(pixels)),
+                                 width, height, 32, width * 4);
+    if (image == 0)
+        return 0;
+    image->byte_order = FbTk::PixelUtil::nativeByteOrder();
+
+    Pixmap argb = XCreatePixmap(disp, RootWindow(disp, screen), width, height, 32);
+    FbTk::GContext argb_gc(argb);
+    XPutImage(disp, argb, argb_gc.gc(), image, 0, 0, 0, 0, width, height);
+    image->data = 0;
+    XDestroyImage(image);
+
+    Pixmap pixmap = XCreatePixmap(disp, RootWindow(disp, screen),
+                                  width, height, DefaultDepth(disp, screen));
+    FbTk::GContext gc(pixmap);
+    gc.setForeground(background);
+    XFillRectangle(disp, pixmap, gc.gc(), 0, 0, width, height);
+
+    Picture src = XRenderCreatePicture(disp, argb, argb_format, 0, 0);
+    Picture dest = XRenderCreatePicture(disp, pixmap, dest_format, 0, 0);
+    XRenderComposite(disp, PictOpOver, src, None, dest,
+                     0, 0, 0, 0, 0, 0, width, height);
+    XRenderFreePicture(disp, dest);
+    XRenderFreePicture(disp, src);
+    XFreePixmap(disp, argb);
+
+    return pixmap;
+#else
+    return 0;
+#endif // HAVE_XRENDER
+}
+
+void IconCache::freeNetIcon(Window client) {
+    if (m_net_icons.erase(client) != 0)
+        purge(client);
+}
+
+Pixmap IconCache::insert(const Key &key, Pixmap pixmap,
+                         unsigned int width, unsigned int height, int depth) {
+    size_t size = width * height * bytesPerPixel(depth);
+    m_entries.push_front(Entry(key, pixmap, depth, size));
+    m_map[key] = m_entries.begin();
+    m_size += size;
+    shrink();
+    return pixmap;
+}
+
+void IconCache::purge(XID icon) {
+    if (icon == 0)
+        return;
+
+    EntryList::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (it->key.icon == icon)
+            erase(it++);
+        else
+            ++it;
+    }
+}
+
+void IconCache::shrink() {
+    // always keep the newest pixmap, it might be in use by the caller
+    while (m_size > m_budget && m_entries.size() > 1)
+        erase(--m_entries.end());
+}
+
+void IconCache::erase(EntryList::iterator it) {
+    // windows keep their own reference to background pixmaps,
+    // so it's safe to free pixmaps that are still shown
+    XFreePixmap(FbTk::App::instance()->display(), it->pixmap);
+    m_size -= it->size;
+    m_map.erase(it->key);
+    m_entries.erase(it);
+}
+
+} // end namespace FbPager
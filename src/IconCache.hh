@@ -0,0 +1,164 @@
+// IconCache.hh for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+// $Id$
+
+#ifndef FBPAGER_ICONCACHE_HH
+#define FBPAGER_ICONCACHE_HH
+
+#include "FbTk/NotCopyable.hh"
+#include "FbTk/ImageScaler.hh"
+
+#include "DiskCache.hh"
+
+#include <X11/Xlib.h>
+
+#include <map>
+#include <list>
+#include <vector>
+
+namespace FbPager {
+
+/**
+   Holds scaled copies of client icons.
+   Scaled pixmaps are keyed by icon pixmap and size so mini windows
+   with the same icon and size share one pixmap. The least recently
+   used pixmaps are freed when the cache grows above its budget.
+   The icon pixmap of each client (WM_HINTS) is remembered until
+   the client changes its hints.
+   With RENDER, ARGB icons from _NET_WM_ICON are preferred. The smallest
+   one that covers the requested size is premultiplied and kept per
+   client, scaled with FbTk::ImageScaler and blended onto the background
+   on the server. Scaled ARGB icons are also kept in a DiskCache keyed by
+   their content, so other and later fbpager instances don't scale them
+   again. The property is only read again when the client changes it or
+   needs a bigger image.
+*/
+class IconCache: private FbTk::NotCopyable {
+public:
+    /**
+       @param budget maximum size of the scaled pixmaps in bytes
+       @param disk_budget maximum size of the disk cache in bytes, 0 disables it
+    */
+    IconCache(size_t budget, size_t disk_budget);
+    ~IconCache();
+
+    void setBudget(size_t budget);
+    void setDiskBudget(size_t budget) { m_disk.setBudget(budget); }
+    /**
+       Scaled icon of client
+       @param background pixel shown through transparent parts of ARGB icons
+       @param depth if not 0, set to the depth of the returned pixmap
+       @return pixmap owned by the cache, 0 if client has no icon
+    */
+    Pixmap icon(Window client, unsigned int width, unsigned int height,
+                unsigned long background, int *depth = 0);
+    /// forget client's icon if event changed WM_HINTS or _NET_WM_ICON
+    /// @return true if an icon was dropped
+    bool propertyNotify(const XPropertyEvent &event);
+    /// forget client's icons
+    void remove(Window client);
+    /// free all pixmaps and hints
+    void clear();
+    /// @return size of the scaled pixmaps in bytes
+    size_t size() const { return m_size; }
+
+private:
+    struct Key {
+        Key(XID i, unsigned int w, unsigned int h, unsigned long bg = 0):
+            icon(i), width(w), height(h), background(bg) { }
+        bool operator < (const Key &other) const {
+            if (icon != other.icon)
+                return icon < other.icon;
+            if (width != other.width)
+                return width < other.width;
+            if (height != other.height)
+                return height < other.height;
+            return background < other.background;
+        }
+        XID icon; ///< icon pixmap, or client window for ARGB icons
+        unsigned int width, height;
+        unsigned long background; ///< only used by ARGB icons
+    };
+    struct Entry {
+        Entry(const Key &k, Pixmap pm, int d, size_t s):
+            key(k), pixmap(pm), depth(d), size(s) { }
+        Key key;
+        Pixmap pixmap; ///< scaled icon
+        int depth;
+        size_t size; ///< bytes used by pixmap
+    };
+    typedef std::list<Entry> EntryList;
+    typedef std::map<Key, EntryList::iterator> EntryMap;
+    typedef std::map<Window, Pixmap> HintMap;
+    /// the _NET_WM_ICON image chosen for a client
+    struct NetIcon {
+        NetIcon():hash(0), width(0), height(0), largest(true) { }
+        unsigned long long hash; ///< content of the image, 0 if the client has none
+        unsigned int width, height;
+        bool largest; ///< no bigger image in the property
+        std::vector<unsigned int> pixels; ///< premultiplied image
+    };
+    typedef std::map<Window, NetIcon> NetIconMap;
+
+    /// @return icon pixmap from client's WM_HINTS
+    Pixmap iconPixmap(Window client);
+    /**
+       Client's ARGB icon scaled to size, from the disk cache or
+       scaled from the image kept for client
+       @return premultiplied pixels, 0 if the client has none
+    */
+    const unsigned int *netIcon(Window client, unsigned int width, unsigned int height,
+                                DiskCache::Mapping &mapping);
+    /// reads _NET_WM_ICON and keeps the best image for size in icon
+    void loadNetIcon(Window client, NetIcon &icon,
+                     unsigned int width, unsigned int height);
+    /// scales icon into m_scaled and stores it in the disk cache
+    const unsigned int *scaleNetIcon(const NetIcon &icon,
+                                     unsigned int width, unsigned int height);
+    /// uploads pixels and blends them onto background
+    Pixmap renderNetIcon(const unsigned int *pixels,
+                         unsigned int width, unsigned int height,
+                         unsigned long background);
+    void freeNetIcon(Window client);
+    /// add pixmap to the front of the cache
+    Pixmap insert(const Key &key, Pixmap pixmap,
+                  unsigned int width, unsigned int height, int depth);
+    /// free all scaled copies of icon
+    void purge(XID icon);
+    /// free least recently used pixmaps until size is within budget
+    void shrink();
+    void erase(EntryList::iterator it);
+
+    EntryList m_entries; ///< most recently used first
+    EntryMap m_map;
+    HintMap m_hints;
+    NetIconMap m_net_icons;
+    Atom m_net_wm_icon;
+    DiskCache m_disk;
+    FbTk::ImageScaler m_scaler;
+    std::vector<unsigned int> m_scaled; ///< premultiplied pixels
+    size_t m_budget, m_size;
+};
+
+} // end namespace FbPager
+
+#endif // FBPAGER_ICONCACHE_HH
@@ -0,0 +1,206 @@
+// StickyLayer.cc for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+
+#include "StickyLayer.hh"
+
+#include "Workspace.hh"
+#include "WindowIndex.hh"
+#include "GeometryCache.hh"
+#include "ScaleWindowToWindow.hh"
+
+#include <algorithm>
+
+namespace FbPager {
+
+StickyLayer::StickyLayer(WindowIndex &index, GeometryCache &geometry):
+    m_index(index),
+    m_geometry(geometry),
+    m_border_width(1) {
+}
+
+void StickyLayer::addWorkspace(Workspace &workspace) {
+    m_workspaces.push_back(&workspace);
+    Clients::iterator it = m_clients.begin();
+    Clients::iterator it_end = m_clients.end();
+    for (; it != it_end; ++it)
+        m_index.add(workspace, it->first);
+}
+
+void StickyLayer::removeWorkspace(Workspace &workspace) {
+    m_workspaces.erase(std::remove(m_workspaces.begin(), m_workspaces.end(), &workspace),
+                       m_workspaces.end());
+    Clients::iterator it = m_clients.begin();
+    Clients::iterator it_end = m_clients.end();
+    for (; it != it_end; ++it)
+        m_index.remove(workspace, it->first);
+}
+
+void StickyLayer::add(Window client) {
+    if (!has(client)) {
+        m_clients[client] = MiniWindow();
+        m_stacking.push_back(client);
+    }
+
+    // the workspaces might have replaced their entries
+    for (size_t i = 0; i < m_workspaces.size(); ++i)
+        m_index.add(*m_workspaces[i], client);
+}
+
+bool StickyLayer::remove(Window client) {
+    if (!has(client))
+        return false;
+
+    invalidate(client);
+    for (size_t i = 0; i < m_workspaces.size(); ++i)
+        m_index.remove(*m_workspaces[i], client);
+    m_clients.erase(client);
+    m_stacking.erase(std::remove(m_stacking.begin(), m_stacking.end(), client),
+                     m_stacking.end());
+    m_iconified.erase(client);
+    return true;
+}
+
+void StickyLayer::resize() {
+    Clients::iterator it = m_clients.begin();
+    Clients::iterator it_end = m_clients.end();
+    for (; it != it_end; ++it)
+        updateGeometry(it->first);
+}
+
+void StickyLayer::setBorderWidth(unsigned int width) {
+    m_border_width = width;
+}
+
+void StickyLayer::updateGeometry(Window client) {
+    Clients::iterator it = m_clients.find(client);
+    if (it == m_clients.end() || m_workspaces.empty())
+        return;
+
+    // once for all workspaces, they have the same size
+    const FbTk::FbWindow &workspace = m_workspaces.front()->window();
+    if (workspace.width() == 0 || workspace.height() == 0)
+        return;
+
+    GeometryCache::Geometry geom;
+    if (!m_geometry.geometry(client, geom))
+        return;
+
+    int x = geom.x, y = geom.y;
+    unsigned int w = geom.width, h = geom.height;
+    const FbTk::FbWindow &rootwin = m_geometry.root();
+    scaleFromWindowToWindow(rootwin, workspace, x, y);
+    scaleFromWindowToWindow(rootwin, workspace, w, h);
+    w -= std::min(w, m_border_width);
+    if (w == 0)
+        w = 1;
+    if (h == 0)
+        h = 1;
+
+    // where it was and where it is now
+    invalidate(client);
+    it->second.x = x;
+    it->second.y = y;
+    it->second.width = w;
+    it->second.height = h;
+    invalidate(client);
+}
+
+void StickyLayer::shade(Window client) {
+    Clients::iterator it = m_clients.find(client);
+    if (it == m_clients.end() || m_workspaces.empty())
+        return;
+
+    invalidate(client);
+    it->second.height = std::max(m_workspaces.front()->window().height()/30, 1u);
+}
+
+void StickyLayer::setIconic(Window client, bool iconic) {
+    if (!has(client) || iconic == this->iconic(client))
+        return;
+
+    if (iconic)
+        m_iconified.insert(client);
+    else
+        m_iconified.erase(client);
+    invalidate(client);
+}
+
+void StickyLayer::raise(Window client) {
+    restack(client, true);
+}
+
+void StickyLayer::lower(Window client) {
+    restack(client, false);
+}
+
+void StickyLayer::restack(Window client, bool raise) {
+    std::vector<Window>::iterator it = std::find(m_stacking.begin(),
+                                                 m_stacking.end(), client);
+    if (it == m_stacking.end())
+        return;
+
+    m_stacking.erase(it);
+    if (raise)
+        m_stacking.push_back(client);
+    else
+        m_stacking.insert(m_stacking.begin(), client);
+    invalidate(client);
+}
+
+void StickyLayer::invalidate(Window client) {
+    const MiniWindow *mini = find(client);
+    if (mini == 0)
+        return;
+
+    XRectangle area;
+    area.x = mini->x;
+    area.y = mini->y;
+    area.width = mini->width + 2*m_border_width;
+    area.height = mini->height + 2*m_border_width;
+    for (size_t i = 0; i < m_workspaces.size(); ++i)
+        m_workspaces[i]->invalidateBuffer(area);
+}
+
+const MiniWindow *StickyLayer::find(Window client) const {
+    Clients::const_iterator it = m_clients.find(client);
+    if (it == m_clients.end())
+        return 0;
+    return &it->second;
+}
+
+Window StickyLayer::clientAt(int x, int y) const {
+    const int border = 2*m_border_width;
+    // top first
+    for (size_t i = m_stacking.size(); i > 0; --i) {
+        Window client = m_stacking[i - 1];
+        const MiniWindow *mini = find(client);
+        if (mini == 0 || iconic(client))
+            continue;
+
+        if (x >= mini->x && x < mini->x + static_cast<int>(mini->width) + border &&
+            y >= mini->y && y < mini->y + static_cast<int>(mini->height) + border)
+            return client;
+    }
+    return 0;
+}
+
+} // end namespace FbPager
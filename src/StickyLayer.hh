@@ -0,0 +1,106 @@
+// StickyLayer.hh for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+
+#ifndef FBPAGER_STICKYLAYER_HH
+#define FBPAGER_STICKYLAYER_HH
+
+#include "FbTk/NotCopyable.hh"
+
+#include <X11/Xlib.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace FbPager {
+
+class Workspace;
+class WindowIndex;
+class GeometryCache;
+
+/// mini window that is only drawn, position of the border and size inside of it
+struct MiniWindow {
+    MiniWindow():x(0), y(0), width(1), height(1) { }
+    int x, y;
+    unsigned int width, height;
+};
+
+/**
+   Sticky clients in single window mode. Geometry, shade and iconic
+   state are kept once for all workspaces, each workspace draws them
+   on top of its own mini windows.
+   The clients are added to WindowIndex on every workspace.
+*/
+class StickyLayer: private FbTk::NotCopyable {
+public:
+    typedef std::map<Window, MiniWindow> Clients;
+
+    StickyLayer(WindowIndex &index, GeometryCache &geometry);
+
+    void addWorkspace(Workspace &workspace);
+    void removeWorkspace(Workspace &workspace);
+
+    /// add client, or register it again on all workspaces
+    void add(Window client);
+    /// @return true if client was in the layer
+    bool remove(Window client);
+    bool has(Window client) const { return m_clients.find(client) != m_clients.end(); }
+
+    /// scale the clients again after the workspaces were resized
+    void resize();
+    /// border of the mini windows
+    void setBorderWidth(unsigned int width);
+
+    void updateGeometry(Window client);
+    void shade(Window client);
+    void setIconic(Window client, bool iconic);
+    void raise(Window client);
+    void lower(Window client);
+    /// redraw client on all workspaces
+    void invalidate(Window client);
+
+    /// @return mini window of client, 0 on failure
+    const MiniWindow *find(Window client) const;
+    /**
+       @brief Find the client drawn at x, y in workspace coordinates
+       @return 0 on failure
+    */
+    Window clientAt(int x, int y) const;
+    /// @return clients in stacking order, bottom first
+    const std::vector<Window> &stacking() const { return m_stacking; }
+    bool iconic(Window client) const { return m_iconified.find(client) != m_iconified.end(); }
+
+private:
+    void restack(Window client, bool raise);
+
+    WindowIndex &m_index;
+    GeometryCache &m_geometry;
+    std::vector<Workspace *> m_workspaces;
+    Clients m_clients;
+    std::vector<Window> m_stacking; ///< m_clients, bottom first
+    std::set<Window> m_iconified;
+    unsigned int m_border_width;
+};
+
+} // end namespace FbPager
+
+#endif // FBPAGER_STICKYLAYER_HH
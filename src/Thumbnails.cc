@@ -0,0 +1,407 @@
+// Thumbnails.cc for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+// $Id$
+
+#include "Thumbnails.hh"
+
+#include "FbTk/App.hh"
+#include "FbTk/EventManager.hh"
+#include "FbTk/Transparent.hh"
+
+#include "WindowIndex.hh"
+#include "Workspace.hh"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#ifdef HAVE_XCOMPOSITE
+#include <X11/extensions/Xcomposite.h>
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xrender.h>
+#endif // HAVE_XCOMPOSITE
+
+#include <cstdio>
+#include <iostream>
+using namespace std;
+
+namespace FbPager {
+
+Thumbnails::Thumbnails(FbTk::EventHandler &handler, WindowIndex &index, int screen_num):
+    m_handler(handler),
+    m_index(index),
+    m_screen_num(screen_num),
+    m_available(false),
+    m_enabled(false),
+    m_damage_event(0),
+    m_interval(0),
+    m_refresh_cmd(*this, &Thumbnails::refresh),
+    m_timer(m_refresh_cmd) {
+
+#ifdef HAVE_XCOMPOSITE
+    Display *disp = FbTk::App::instance()->display();
+
+    // NameWindowPixmap needs Composite 0.2
+    int event_base, error_base, major = 0, minor = 2;
+    if (!FbTk::Transparent::haveRender() ||
+        !XCompositeQueryExtension(disp, &event_base, &error_base) ||
+        !XCompositeQueryVersion(disp, &major, &minor) ||
+        (major == 0 && minor < 2) ||
+        !XDamageQueryExtension(disp, &m_damage_event, &error_base))
+        return;
+
+    m_available = true;
+#endif // HAVE_XCOMPOSITE
+}
+
+Thumbnails::~Thumbnails() {
+    clear();
+}
+
+void Thumbnails::setEnabled(bool enabled) {
+    if (enabled == m_enabled)
+        return;
+
+    if (!enabled) {
+        clear();
+        m_enabled = false;
+        return;
+    }
+
+    if (!m_available) {
+        cerr<<"Warning! FbPager: Window thumbnails need the Composite, Damage and RENDER extensions."<<endl;
+        return;
+    }
+
+    // without a compositing manager the windows have no content to take
+    Display *disp = FbTk::App::instance()->display();
+    char cm_atom_name[32];
+    sprintf(cm_atom_name, "_NET_WM_CM_S%d", m_screen_num);
+    if (XGetSelectionOwner(disp, XInternAtom(disp, cm_atom_name, False)) == None) {
+        cerr<<"Warning! FbPager: Window thumbnails need a compositing manager."<<endl;
+        return;
+    }
+
+    m_enabled = true;
+}
+
+Pixmap Thumbnails::thumbnail(Window client, unsigned int width, unsigned int height) {
+    if (!m_enabled || width == 0 || height == 0)
+        return 0;
+
+    ThumbnailMap::iterator it = m_thumbnails.find(client);
+    if (it == m_thumbnails.end()) {
+        it = m_thumbnails.insert(make_pair(client, Thumbnail())).first;
+        create(client, it->second);
+    }
+
+    Thumbnail &thumb = it->second;
+    if (!thumb.valid)
+        return 0;
+
+    if (thumb.pixmap == 0 || thumb.width != width || thumb.height != height) {
+        Display *disp = FbTk::App::instance()->display();
+        if (thumb.pixmap != 0)
+            XFreePixmap(disp, thumb.pixmap);
+        thumb.pixmap = XCreatePixmap(disp, RootWindow(disp, m_screen_num),
+                                     width, height,
+                                     DefaultDepth(disp, m_screen_num));
+        thumb.width = width;
+        thumb.height = height;
+        render(thumb);
+    }
+
+    return thumb.pixmap;
+}
+
+bool Thumbnails::handleEvent(XEvent &event) {
+    if (!m_enabled)
+        return false;
+
+    switch (event.type) {
+    case MapNotify:
+        invalidate(event.xmap.window);
+        return false;
+    case ReparentNotify:
+        invalidate(event.xreparent.window);
+        return false;
+    case ConfigureNotify: {
+        // the frame pixmap has a fixed size
+        std::map<Window, Window>::iterator frame_it =
+            m_frames.find(event.xconfigure.window);
+        if (frame_it == m_frames.end())
+            return false;
+        ThumbnailMap::iterator it = m_thumbnails.find(frame_it->second);
+        if (it == m_thumbnails.end() || !it->second.valid)
+            return false;
+        Thumbnail &thumb = it->second;
+        thumb.new_frame_width = event.xconfigure.width;
+        thumb.new_frame_height = event.xconfigure.height;
+        const bool resized = thumb.new_frame_width != thumb.frame_width ||
+            thumb.new_frame_height != thumb.frame_height;
+        // taken again when the thumbnail is due, not on every step of a resize
+        if (resized != thumb.stale) {
+            thumb.stale = resized;
+            if (resized && !thumb.dirty) {
+                thumb.dirty = true;
+                schedule();
+            }
+        }
+        return false;
+    }
+    default:
+        break;
+    }
+
+#ifdef HAVE_XCOMPOSITE
+    if (event.type != m_damage_event + XDamageNotify)
+        return false;
+
+    XDamageNotifyEvent &damage_event = reinterpret_cast<XDamageNotifyEvent &>(event);
+    // the damage is subtracted in render(), until then no more events come
+    std::map<Window, Window>::iterator frame_it = m_frames.find(damage_event.drawable);
+    if (frame_it == m_frames.end())
+        return true;
+
+    ThumbnailMap::iterator it = m_thumbnails.find(frame_it->second);
+    if (it == m_thumbnails.end())
+        return true;
+
+    if (!it->second.dirty) {
+        it->second.dirty = true;
+        schedule();
+    }
+    return true;
+#else
+    return false;
+#endif // HAVE_XCOMPOSITE
+}
+
+void Thumbnails::invalidate(Window win) {
+    ThumbnailMap::iterator it = m_thumbnails.find(win);
+    if (it == m_thumbnails.end()) {
+        std::map<Window, Window>::iterator frame_it = m_frames.find(win);
+        if (frame_it == m_frames.end())
+            return;
+        it = m_thumbnails.find(frame_it->second);
+        if (it == m_thumbnails.end())
+            return;
+    }
+
+    // recreate on next use, the frame pixmap is only valid for
+    // one size and one mapping of the frame
+    Window client = it->first;
+    destroy(it->second);
+    m_thumbnails.erase(it);
+
+    const WindowIndex::Entries *entries = m_index.findClient(client);
+    if (entries == 0)
+        return;
+    for (size_t i = 0; i < entries->size(); ++i)
+        (*entries)[i].workspace->updateThumbnail(client);
+}
+
+void Thumbnails::remove(Window client) {
+    ThumbnailMap::iterator it = m_thumbnails.find(client);
+    if (it == m_thumbnails.end())
+        return;
+
+    destroy(it->second);
+    m_thumbnails.erase(it);
+}
+
+void Thumbnails::clear() {
+    ThumbnailMap::iterator it = m_thumbnails.begin();
+    ThumbnailMap::iterator it_end = m_thumbnails.end();
+    for (; it != it_end; ++it)
+        destroy(it->second);
+    m_thumbnails.clear();
+    m_timer.stop();
+}
+
+void Thumbnails::create(Window client, Thumbnail &thumb) {
+#ifdef HAVE_XCOMPOSITE
+    Display *disp = FbTk::App::instance()->display();
+
+    // find the top level window, the one the compositing manager redirects
+    Window frame = client;
+    Window root_return, parent, *children = 0;
+    unsigned int num_children = 0;
+    while (XQueryTree(disp, frame, &root_return, &parent,
+                      &children, &num_children) != 0) {
+        if (children != 0)
+            XFree(children);
+        if (parent == root_return || parent == 0)
+            break;
+        frame = parent;
+    }
+
+    XWindowAttributes attr;
+    if (XGetWindowAttributes(disp, frame, &attr) == 0 ||
+        attr.map_state != IsViewable)
+        return;
+
+    XRenderPictFormat *format = XRenderFindVisualFormat(disp, attr.visual);
+    if (format == 0)
+        return;
+
+    thumb.frame = frame;
+    thumb.visual = attr.visual;
+    thumb.frame_width = attr.width;
+    thumb.frame_height = attr.height;
+    thumb.window_pm = XCompositeNameWindowPixmap(disp, frame);
+    thumb.window_pic = XRenderCreatePicture(disp, thumb.window_pm, format, 0, 0);
+    // bilinear filter and scale factor are set in render()
+    XRenderSetPictureFilter(disp, thumb.window_pic, FilterBilinear, 0, 0);
+    thumb.damage = XDamageCreate(disp, frame, XDamageReportNonEmpty);
+    thumb.valid = true;
+
+    m_frames[frame] = client;
+    if (frame != client)
+        FbTk::EventManager::instance()->add(m_handler, frame);
+#endif // HAVE_XCOMPOSITE
+}
+
+void Thumbnails::destroy(Thumbnail &thumb) {
+    Display *disp = FbTk::App::instance()->display();
+#ifdef HAVE_XCOMPOSITE
+    if (thumb.damage != 0)
+        XDamageDestroy(disp, thumb.damage);
+    if (thumb.window_pic != 0)
+        XRenderFreePicture(disp, thumb.window_pic);
+#endif // HAVE_XCOMPOSITE
+    if (thumb.window_pm != 0)
+        XFreePixmap(disp, thumb.window_pm);
+    if (thumb.pixmap != 0)
+        XFreePixmap(disp, thumb.pixmap);
+    if (thumb.frame != 0) {
+        std::map<Window, Window>::iterator frame_it = m_frames.find(thumb.frame);
+        // without a window manager the client is its own frame
+        if (frame_it != m_frames.end() && frame_it->second != thumb.frame)
+            FbTk::EventManager::instance()->remove(thumb.frame);
+        m_frames.erase(thumb.frame);
+    }
+    thumb = Thumbnail();
+}
+
+void Thumbnails::rebind(Thumbnail &thumb) {
+#ifdef HAVE_XCOMPOSITE
+    Display *disp = FbTk::App::instance()->display();
+    XRenderPictFormat *format = XRenderFindVisualFormat(disp, thumb.visual);
+    if (format == 0)
+        return;
+
+    // the frame and its damage stay, only the content has a new size
+    XRenderFreePicture(disp, thumb.window_pic);
+    XFreePixmap(disp, thumb.window_pm);
+    thumb.frame_width = thumb.new_frame_width;
+    thumb.frame_height = thumb.new_frame_height;
+    thumb.window_pm = XCompositeNameWindowPixmap(disp, thumb.frame);
+    thumb.window_pic = XRenderCreatePicture(disp, thumb.window_pm, format, 0, 0);
+    XRenderSetPictureFilter(disp, thumb.window_pic, FilterBilinear, 0, 0);
+    thumb.stale = false;
+#endif // HAVE_XCOMPOSITE
+}
+
+void Thumbnails::render(Thumbnail &thumb) {
+#ifdef HAVE_XCOMPOSITE
+    if (!thumb.valid)
+        return;
+
+    Display *disp = FbTk::App::instance()->display();
+    // we redraw the whole thumbnail, so the area doesn't matter
+    XDamageSubtract(disp, thumb.damage, None, None);
+    thumb.dirty = false;
+    if (thumb.stale)
+        rebind(thumb);
+    if (thumb.pixmap == 0)
+        return;
+
+    XRenderPictFormat *format =
+        XRenderFindVisualFormat(disp, DefaultVisual(disp, m_screen_num));
+    if (format == 0)
+        return;
+
+    XTransform transform = {{
+        { XDoubleToFixed(static_cast<double>(thumb.frame_width) / thumb.width), 0, 0 },
+        { 0, XDoubleToFixed(static_cast<double>(thumb.frame_height) / thumb.height), 0 },
+        { 0, 0, XDoubleToFixed(1) }
+    }};
+    XRenderSetPictureTransform(disp, thumb.window_pic, &transform);
+
+    Picture dest_pic = XRenderCreatePicture(disp, thumb.pixmap, format, 0, 0);
+    XRenderComposite(disp, PictOpSrc,
+                     thumb.window_pic, None, dest_pic,
+                     0, 0, 0, 0, 0, 0,
+                     thumb.width, thumb.height);
+    XRenderFreePicture(disp, dest_pic);
+
+    thumb.last_update = FbTk::Timer::now();
+#endif // HAVE_XCOMPOSITE
+}
+
+void Thumbnails::refresh() {
+    const FbTk::Timer::Time now = FbTk::Timer::now();
+    ThumbnailMap::iterator it = m_thumbnails.begin();
+    ThumbnailMap::iterator it_end = m_thumbnails.end();
+    for (; it != it_end; ++it) {
+        Thumbnail &thumb = it->second;
+        if (!thumb.dirty || thumb.last_update + m_interval > now)
+            continue;
+
+        render(thumb);
+        // let the workspaces show the new content
+        const WindowIndex::Entries *entries = m_index.findClient(it->first);
+        if (entries == 0)
+            continue;
+        for (size_t i = 0; i < entries->size(); ++i)
+            (*entries)[i].workspace->updateThumbnail(it->first);
+    }
+
+    schedule();
+}
+
+void Thumbnails::schedule() {
+    const FbTk::Timer::Time now = FbTk::Timer::now();
+    bool found = false;
+    FbTk::Timer::Time next = 0;
+    ThumbnailMap::const_iterator it = m_thumbnails.begin();
+    ThumbnailMap::const_iterator it_end = m_thumbnails.end();
+    for (; it != it_end; ++it) {
+        if (!it->second.dirty)
+            continue;
+        FbTk::Timer::Time due = it->second.last_update + m_interval;
+        if (!found || due < next)
+            next = due;
+        found = true;
+    }
+
+    if (!found) {
+        m_timer.stop();
+        return;
+    }
+
+    m_timer.setTimeout(next > now ? next - now : 0);
+    m_timer.start();
+}
+
+} // end namespace FbPager
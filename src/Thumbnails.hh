@@ -0,0 +1,131 @@
+// Thumbnails.hh for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+// $Id$
+
+#ifndef FBPAGER_THUMBNAILS_HH
+#define FBPAGER_THUMBNAILS_HH
+
+#include "FbTk/NotCopyable.hh"
+#include "FbTk/Timer.hh"
+#include "FbTk/SimpleCommand.hh"
+
+#include <X11/Xlib.h>
+
+#include <map>
+
+namespace FbTk {
+class EventHandler;
+}
+
+namespace FbPager {
+
+class WindowIndex;
+
+/**
+   Scaled copies of client window content for the mini windows.
+   Needs a running compositing manager, the Composite, Damage and
+   RENDER extensions. The content of a client's frame is taken with
+   XCompositeNameWindowPixmap and scaled on the server. A thumbnail
+   is only redrawn when Damage reports a change, and at most once per
+   interval so busy windows don't keep the pager busy. The damage is
+   only subtracted when the thumbnail is redrawn, so a busy window
+   sends one damage event per interval. Resized frames are taken
+   again by the same timer.
+*/
+class Thumbnails: private FbTk::NotCopyable {
+public:
+    /// damage events are sent to handler, which should pass them to handleEvent
+    Thumbnails(FbTk::EventHandler &handler, WindowIndex &index, int screen_num);
+    ~Thumbnails();
+
+    /// turn thumbnails on or off, they stay off if the display can't do them
+    void setEnabled(bool enabled);
+    bool enabled() const { return m_enabled; }
+    /// minimum time between two updates of the same thumbnail
+    void setInterval(unsigned int msec) { m_interval = msec; }
+    /**
+       Thumbnail of client's window content
+       @return pixmap owned by Thumbnails, 0 if there is no content to show
+    */
+    Pixmap thumbnail(Window client, unsigned int width, unsigned int height);
+    /**
+       Follows damage, map, reparent and resize of the tracked windows
+       @return true if event was a damage event for one of the thumbnails
+    */
+    bool handleEvent(XEvent &event);
+    /// take new content of client or frame window win on next use
+    void invalidate(Window win);
+    void remove(Window client);
+    void clear();
+
+private:
+    struct Thumbnail {
+        Thumbnail():frame(0), visual(0), damage(0), window_pm(0), window_pic(0),
+                    frame_width(0), frame_height(0),
+                    new_frame_width(0), new_frame_height(0),
+                    pixmap(0), width(0), height(0),
+                    valid(false), dirty(false), stale(false), last_update(0) { }
+        Window frame; ///< top level window of the client
+        Visual *visual; ///< visual of frame
+        unsigned long damage;
+        Pixmap window_pm; ///< frame content from the compositing manager
+        unsigned long window_pic; ///< picture of window_pm
+        unsigned int frame_width, frame_height; ///< size of window_pm
+        unsigned int new_frame_width, new_frame_height; ///< size of the resized frame
+        Pixmap pixmap; ///< scaled content
+        unsigned int width, height; ///< size of pixmap
+        bool valid; ///< wheter the frame is viewable and can be shown
+        bool dirty; ///< damaged since last update
+        bool stale; ///< frame was resized, window_pm has to be taken again
+        FbTk::Timer::Time last_update;
+    };
+    typedef std::map<Window, Thumbnail> ThumbnailMap;
+
+    /// starts tracking client, sets valid if it can be shown
+    void create(Window client, Thumbnail &thumb);
+    /// frees the server side objects of thumb
+    void destroy(Thumbnail &thumb);
+    /// takes the frame content again after the frame was resized
+    void rebind(Thumbnail &thumb);
+    /// scales the frame content into thumb.pixmap
+    void render(Thumbnail &thumb);
+    /// updates damaged thumbnails that are due
+    void refresh();
+    /// starts the timer for the next due thumbnail
+    void schedule();
+
+    ThumbnailMap m_thumbnails; ///< client window to thumbnail
+    std::map<Window, Window> m_frames; ///< frame to client window
+    FbTk::EventHandler &m_handler;
+    WindowIndex &m_index;
+    int m_screen_num;
+    bool m_available; ///< wheter the display can do thumbnails
+    bool m_enabled;
+    int m_damage_event; ///< event base of Damage
+    unsigned int m_interval; ///< minimum update interval in milliseconds
+    FbTk::SimpleCommand<Thumbnails> m_refresh_cmd;
+    FbTk::Timer m_timer;
+};
+
+} // end namespace FbPager
+
+#endif // FBPAGER_THUMBNAILS_HH
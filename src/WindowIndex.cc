@@ -0,0 +1,95 @@
+// WindowIndex.cc for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#include "WindowIndex.hh"
+
+#include "Workspace.hh"
+
+namespace FbPager {
+
+void WindowIndex::addWorkspace(Workspace &workspace) {
+    m_windows[workspace.window().window()] = Entry(&workspace, 0, &workspace.window());
+}
+
+void WindowIndex::removeWorkspace(Workspace &workspace) {
+    m_windows.erase(workspace.window().window());
+}
+
+void WindowIndex::add(Workspace &workspace, Window client, FbTk::FbWindow &win) {
+    remove(workspace, client);
+
+    Entry entry(&workspace, client, &win);
+    m_windows[win.window()] = entry;
+    m_clients[client].push_back(entry);
+}
+
+void WindowIndex::add(Workspace &workspace, Window client) {
+    remove(workspace, client);
+    m_clients[client].push_back(Entry(&workspace, client, 0));
+}
+
+void WindowIndex::remove(Workspace &workspace, Window client) {
+    ClientMap::iterator it = m_clients.find(client);
+    if (it == m_clients.end())
+        return;
+
+    Entries &entries = it->second;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].workspace != &workspace)
+            continue;
+        if (entries[i].window != 0)
+            m_windows.erase(entries[i].window->window());
+        entries.erase(entries.begin() + i);
+        break;
+    }
+
+    if (entries.empty())
+        m_clients.erase(it);
+}
+
+const WindowIndex::Entry *WindowIndex::find(Window win) const {
+    WindowMap::const_iterator it = m_windows.find(win);
+    if (it == m_windows.end())
+        return 0;
+    return &it->second;
+}
+
+const WindowIndex::Entries *WindowIndex::findClient(Window client) const {
+    ClientMap::const_iterator it = m_clients.find(client);
+    if (it == m_clients.end())
+        return 0;
+    return &it->second;
+}
+
+const WindowIndex::Entry *WindowIndex::findClient(Window client,
+                                                  const Workspace &workspace) const {
+    const Entries *entries = findClient(client);
+    if (entries == 0)
+        return 0;
+
+    for (size_t i = 0; i < entries->size(); ++i) {
+        if ((*entries)[i].workspace == &workspace)
+            return &(*entries)[i];
+    }
+    return 0;
+}
+
+} // end namespace FbPager
@@ -0,0 +1,89 @@
+// WindowIndex.hh for FbPager
+// Copyright (c) 2004 Henrik Kinnunen (fluxgen at users.sourceforge.net)
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+
+
+#ifndef FBPAGER_WINDOWINDEX_HH
+#define FBPAGER_WINDOWINDEX_HH
+
+#include "FbTk/NotCopyable.hh"
+
+#include <X11/Xlib.h>
+
+#include <map>
+#include <vector>
+
+namespace FbTk {
+class FbWindow;
+}
+
+namespace FbPager {
+
+class Workspace;
+
+/**
+   Maps X windows to where they are shown in the pager.
+   Workspace windows and mini windows map to one entry,
+   client windows map to one entry per workspace they are on.
+   Kept up to date by Workspace.
+*/
+class WindowIndex: private FbTk::NotCopyable {
+public:
+    struct Entry {
+        Entry():workspace(0), client(0), window(0) { }
+        Entry(Workspace *ws, Window c, FbTk::FbWindow *win):
+            workspace(ws), client(c), window(win) { }
+        Workspace *workspace; ///< workspace the window belongs to
+        Window client; ///< client window, 0 for workspace windows
+        FbTk::FbWindow *window; ///< mini window or workspace window, 0 if drawn by the workspace
+    };
+    typedef std::vector<Entry> Entries;
+
+    void addWorkspace(Workspace &workspace);
+    void removeWorkspace(Workspace &workspace);
+    /// add mini window win for client on workspace
+    void add(Workspace &workspace, Window client, FbTk::FbWindow &win);
+    /// add client on workspace, drawn without a mini window
+    void add(Workspace &workspace, Window client);
+    /// remove client from workspace
+    void remove(Workspace &workspace, Window client);
+
+    /**
+       Find entry for a mini window or a workspace window
+       @return 0 on failure
+    */
+    const Entry *find(Window win) const;
+    /**
+       Find the entries for client on all workspaces
+       @return 0 if client isn't shown on any workspace
+    */
+    const Entries *findClient(Window client) const;
+    /// @return entry for client on workspace, 0 on failure
+    const Entry *findClient(Window client, const Workspace &workspace) const;
+
+private:
+    typedef std::map<Window, Entry> WindowMap;
+    typedef std::map<Window, Entries> ClientMap;
+    WindowMap m_windows; ///< mini windows and workspace windows
+    ClientMap m_clients; ///< client windows
+};
+
+} // end namespace FbPager
+
+#endif // FBPAGER_WINDOWINDEX_HH
@@ -26,9 +26,14 @@
 #include "FbTk/App.hh"
 #include "FbTk/Color.hh"
 #include "FbTk/EventManager.hh"
+#include "FbTk/GContext.hh"
+#include "FbTk/RedrawScheduler.hh"
 
 #include "ScaleWindowToWindow.hh"
-#include "FbRootWindow.hh"
+#include "WindowIndex.hh"
+#include "GeometryCache.hh"
+#include "IconCache.hh"
+#include "Thumbnails.hh"
 
 #include <X11/Xutil.h>
 
@@ -37,11 +42,93 @@
 #include <functional>
 using namespace std;
 
+namespace {
+
+XRectangle rectangle(int x, int y, unsigned int width, unsigned int height) {
+    XRectangle rect;
+    rect.x = x;
+    rect.y = y;
+    rect.width = width;
+    rect.height = height;
+    return rect;
+}
+
+bool intersects(const XRectangle &a, const XRectangle &b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width &&
+        a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+XRectangle boundingBox(const std::vector<XRectangle> &rects) {
+    int x1 = rects[0].x, y1 = rects[0].y;
+    int x2 = x1 + rects[0].width, y2 = y1 + rects[0].height;
+    for (size_t i = 1; i < rects.size(); ++i) {
+        x1 = std::min(x1, static_cast<int>(rects[i].x));
+        y1 = std::min(y1, static_cast<int>(rects[i].y));
+        x2 = std::max(x2, rects[i].x + static_cast<int>(rects[i].width));
+        y2 = std::max(y2, rects[i].y + static_cast<int>(rects[i].height));
+    }
+    return rectangle(x1, y1, x2 - x1, y2 - y1);
+}
+
+/**
+   Mini windows that don't overlap each other, so they can be
+   drawn with one request per color in any order.
+*/
+struct MiniWindowBatch {
+    std::vector<XRectangle> area; ///< mini windows with border
+    std::vector<XRectangle> borders; ///< four sides per mini window
+    std::vector<XRectangle> fills[2]; ///< unfocused and focused
+
+    bool overlaps(const XRectangle &rect) const {
+        for (size_t i = 0; i < area.size(); ++i) {
+            if (intersects(area[i], rect))
+                return true;
+        }
+        return false;
+    }
+
+    void addBorder(const XRectangle &rect, unsigned int border) {
+        if (border == 0)
+            return;
+        borders.push_back(rectangle(rect.x, rect.y, rect.width, border));
+        borders.push_back(rectangle(rect.x, rect.y + rect.height - border,
+                                    rect.width, border));
+        borders.push_back(rectangle(rect.x, rect.y + border,
+                                    border, rect.height - 2*border));
+        borders.push_back(rectangle(rect.x + rect.width - border, rect.y + border,
+                                    border, rect.height - 2*border));
+    }
+
+    void fill(Drawable dest, GC gc, std::vector<XRectangle> &rects,
+              const FbTk::Color &color) {
+        if (rects.empty())
+            return;
+        XSetForeground(FbTk::App::instance()->display(), gc, color.pixel());
+        XFillRectangles(FbTk::App::instance()->display(), dest, gc,
+                        &rects[0], rects.size());
+        rects.clear();
+    }
+
+    void draw(Drawable dest, GC gc, const FbTk::Color &border_color,
+              const FbTk::Color &color, const FbTk::Color &focused_color) {
+        fill(dest, gc, borders, border_color);
+        fill(dest, gc, fills[0], color);
+        fill(dest, gc, fills[1], focused_color);
+        area.clear();
+    }
+};
+
+} // end anonymous namespace
+
 namespace FbPager {
 
 Window Workspace::s_focused_window = 0;
 
 Workspace::Workspace(FbTk::EventHandler &evh,
+                     WindowIndex &index, GeometryCache &geometry,
+                     IconCache &icons, Thumbnails &thumbnails,
+                     StickyLayer &sticky,
+                     unsigned int number,
                      FbTk::FbWindow &parent, unsigned int width, unsigned int height,
                      const FbTk::Color &focused_win_color,
                      const FbTk::Color &wincolor, const FbTk::Color &border_color,
@@ -55,33 +142,89 @@ Workspace::Workspace(FbTk::EventHandler &evh,
              width, height, // size
              ButtonPressMask | ButtonReleaseMask | ExposureMask | ButtonMotionMask),
     m_eventhandler(evh),
+    m_index(index),
+    m_geometry(geometry),
+    m_icons(icons),
+    m_thumbnails(thumbnails),
+    m_sticky(sticky),
+    m_number(number),
+    m_single_window(false),
+    m_focused_client(0),
+    m_grab_client(0),
     m_window_color(wincolor),
     m_focused_window_color(focused_win_color),
     m_window_bordercolor(border_color),
     m_focused_window(0),
     m_use_pixmap(use_pixmap),
-    m_window_border_width(window_border_width) {
-
+    m_window_border_width(window_border_width),
+    m_background_color(background_color),
+    m_alpha(0),
+    m_use_buffer(false),
+    m_show_snapshot(false),
+    m_render_cmd(*this, &Workspace::renderBuffer),
+    m_render_timer(m_render_cmd) {
+
+    m_render_timer.setTimeout(0);
     m_window.setBackgroundColor(background_color);
     FbTk::EventManager::instance()->add(evh, m_window);
+    m_index.addWorkspace(*this);
+    m_sticky.addWorkspace(*this);
 }
 
 Workspace::~Workspace() {
+    ungrab();
+    m_sticky.removeWorkspace(*this);
+    MiniWindowList::iterator mini_it = m_miniwindows.begin();
+    MiniWindowList::iterator mini_it_end = m_miniwindows.end();
+    for (; mini_it != mini_it_end; ++mini_it) {
+        FbTk::EventManager::instance()->remove(mini_it->first);
+        m_index.remove(*this, mini_it->first);
+    }
+
     WindowList::iterator it = m_windowlist.begin();
     WindowList::iterator it_end = m_windowlist.end();
     for (; it != it_end; ++it) {
         FbTk::EventManager::instance()->remove(*(*it).second);
         FbTk::EventManager::instance()->remove((*it).first);
+        m_index.remove(*this, (*it).first);
         delete (*it).second;
     }
 
+    m_index.removeWorkspace(*this);
     FbTk::EventManager::instance()->remove(m_window);
 }
 
 void Workspace::add(Window win) {
+    // new windows are on top
+    m_stacking.erase(std::remove(m_stacking.begin(), m_stacking.end(), win),
+                     m_stacking.end());
+    m_stacking.push_back(win);
+
+    if (m_single_window) {
+        // only drawn, no window for it
+        m_miniwindows[win] = MiniWindow();
+        // once for all workspaces
+        if (m_index.findClient(win) == 0) {
+            XSelectInput(FbTk::App::instance()->display(), win,
+                         PropertyChangeMask | // for shade/iconic state
+                         StructureNotifyMask // for pos and size
+                         );
+            FbTk::EventManager::instance()->add(m_eventhandler, win);
+        }
+        m_index.add(*this, win);
+
+        m_iconified.erase(win);
+        updateGeometry(win);
+        return;
+    }
+
     FbTk::FbWindow *fbwin = find(win);
-    if (fbwin != 0)
+    if (fbwin != 0) {
+        m_index.remove(*this, win);
+        if (fbwin == m_focused_window)
+            m_focused_window = 0;
         delete fbwin;
+    }
 
 
     fbwin = new FbTk::FbWindow(m_window,  // parent
@@ -91,16 +234,20 @@ void Workspace::add(Window win) {
                                ExposureMask);
     //    fbwin->setAlpha(m_window.alpha());
 
-    XSelectInput(FbTk::App::instance()->display(), win,
-                 PropertyChangeMask | // for shade/iconic state
-                 StructureNotifyMask // for pos and size
-                 );
+    // once for all workspaces
+    if (m_index.findClient(win) == 0) {
+        XSelectInput(FbTk::App::instance()->display(), win,
+                     PropertyChangeMask | // for shade/iconic state
+                     StructureNotifyMask // for pos and size
+                     );
+        FbTk::EventManager::instance()->add(m_eventhandler, win);
+    }
     // add to event manager
     FbTk::EventManager::instance()->add(m_eventhandler, *fbwin);
-    FbTk::EventManager::instance()->add(m_eventhandler, win);
 
     // add window to list
     m_windowlist[win] = fbwin;
+    m_index.add(*this, win, *fbwin);
 
     // update pos and size
     updateGeometry(win);
@@ -108,25 +255,44 @@ void Workspace::add(Window win) {
     fbwin->show();
     fbwin->setBorderWidth(m_window_border_width);
     fbwin->setBorderColor(m_window_bordercolor);
+    m_iconified.erase(win);
 
     updateBackground(win, m_window_color);
 }
 
 void Workspace::resize(unsigned int width, unsigned int height) {
     m_window.resize(width, height);
+    if (m_snapshot.drawable() != 0) {
+        m_snapshot.scale(width, height);
+        if (showingSnapshot() && !m_use_buffer)
+            m_window.setBackgroundPixmap(m_snapshot.drawable());
+    }
+    invalidateBuffer();
     WindowList::iterator it = m_windowlist.begin();
     WindowList::iterator it_end = m_windowlist.end();
     for (; it != it_end; ++it) {
         updateGeometry((*it).first);
     }
+    MiniWindowList::iterator mini_it = m_miniwindows.begin();
+    MiniWindowList::iterator mini_it_end = m_miniwindows.end();
+    for (; mini_it != mini_it_end; ++mini_it)
+        updateGeometry(mini_it->first);
 }
 
 
 void Workspace::shadeWindow(Window win) {
+    MiniWindowList::iterator mini = m_miniwindows.find(win);
+    if (mini != m_miniwindows.end()) {
+        invalidateClient(win);
+        mini->second.height = std::max(m_window.height()/30, 1u);
+        return;
+    }
+
     FbTk::FbWindow *fbwin = find(win);
     if (fbwin == 0)
         return;
 
+    invalidateClient(win);
     fbwin->resize(fbwin->width(), m_window.height()/30);
 }
 
@@ -135,32 +301,39 @@ void Workspace::unshadeWindow(Window win) {
 }
 
 void Workspace::iconifyWindow(Window win) {
-    FbTk::FbWindow *fbwin = find(win);
-    if (fbwin == 0)
+    if (!has(win))
         return;
 
-    fbwin->hide();
+    FbTk::FbWindow *fbwin = find(win);
+    if (fbwin != 0)
+        fbwin->hide();
+    m_iconified.insert(win);
+    invalidateClient(win);
 }
 
 void Workspace::deiconifyWindow(Window win) {
+    if (!has(win))
+        return;
+
     FbTk::FbWindow *fbwin = find(win);
     if (fbwin != 0)
-        return;
-    fbwin->show();
+        fbwin->show();
+    if (m_iconified.erase(win) != 0)
+        invalidateClient(win);
 }
 
 void Workspace::lowerWindow(Window win) {
     FbTk::FbWindow *fbwin = find(win);
-    if (fbwin == 0)
-        return;
-    fbwin->lower();
+    if (fbwin != 0)
+        fbwin->lower();
+    restack(win, false);
 }
 
 void Workspace::raiseWindow(Window win) {
     FbTk::FbWindow *fbwin = find(win);
-    if (fbwin == 0)
-        return;
-    fbwin->raise();
+    if (fbwin != 0)
+        fbwin->raise();
+    restack(win, true);
 }
 
 void Workspace::setWindowColor(const std::string &focused,
@@ -177,36 +350,163 @@ void Workspace::setWindowColor(const std::string &focused,
         updateBackground((*it).first, m_window_color);
     }
     updateFocusedWindow();
+    if (m_single_window)
+        invalidateBuffer();
 }
 
 
 void Workspace::setAlpha(unsigned char alpha) {
+    m_alpha = alpha;
     m_window.setAlpha(alpha);
+    // with a back buffer the wallpaper is only composited into the buffer
+    unsigned char mini_alpha = m_use_buffer ? 0 : alpha;
     WindowList::iterator it = m_windowlist.begin();
     WindowList::iterator it_end = m_windowlist.end();
     for (; it != it_end; ++it) {
-        (*it).second->setAlpha(alpha);
+        (*it).second->setAlpha(mini_alpha);
     }
+    invalidateBuffer();
+}
+
+void Workspace::setBackgroundColor(const FbTk::Color &color) {
+    m_background_color = color;
+    if (m_use_buffer)
+        invalidateBuffer();
+    else if (!showingSnapshot())
+        m_window.setBackgroundColor(color);
+}
+
+void Workspace::setUseBuffer(bool use_buffer) {
+    if (m_use_buffer == use_buffer)
+        return;
+
+    m_use_buffer = use_buffer;
+    if (!m_use_buffer) {
+        m_render_timer.stop();
+        m_dirty.clear();
+        m_window.setBufferPixmap(0);
+        m_buffer = 0;
+    }
+
+    // moves the transparency between the buffer and the mini windows
+    setAlpha(m_alpha);
+    updateBackgrounds();
+}
+
+void Workspace::setSingleWindow(bool single) {
+    if (m_single_window == single)
+        return;
+
+    // add the clients again, with or without mini windows
+    std::vector<Window> clients(m_stacking);
+    WindowList::iterator it = m_windowlist.begin();
+    WindowList::iterator it_end = m_windowlist.end();
+    for (; it != it_end; ++it)
+        clients.push_back(it->first);
+
+    for (size_t i = 0; i < clients.size(); ++i)
+        remove(clients[i]);
+
+    m_single_window = single;
+    if (m_single_window)
+        setUseBuffer(true);
+
+    for (size_t i = 0; i < clients.size(); ++i)
+        add(clients[i]);
+
+    m_focused_client = 0;
+    updateFocusedWindow();
+    invalidateBuffer();
+}
+
+void Workspace::takeSnapshot(const FbTk::FbWindow &root) {
+    if (m_window.width() == 0 || m_window.height() == 0)
+        return;
+
+    if (m_snapshot.width() != m_window.width() ||
+        m_snapshot.height() != m_window.height()) {
+        FbTk::FbPixmap snapshot(m_window, m_window.width(), m_window.height(),
+                                m_window.depth());
+        m_snapshot = snapshot.release();
+    }
+
+    m_snapshot.copyScaled(root.window(), 0, 0, root.width(), root.height());
+    if (showingSnapshot())
+        updateBackgrounds();
+}
+
+void Workspace::showSnapshot(bool show) {
+    if (show == m_show_snapshot)
+        return;
+
+    m_show_snapshot = show;
+    if (m_snapshot.drawable() != 0)
+        updateBackgrounds();
+}
+
+void Workspace::dropSnapshot() {
+    bool shown = showingSnapshot();
+    m_snapshot = 0;
+    if (shown)
+        updateBackgrounds();
+}
+
+void Workspace::updateBackgrounds() {
+    if (!m_use_buffer) {
+        if (showingSnapshot())
+            m_window.setBackgroundPixmap(m_snapshot.drawable());
+        else
+            m_window.setBackgroundColor(m_background_color);
+    }
+
+    WindowList::iterator it = m_windowlist.begin();
+    WindowList::iterator it_end = m_windowlist.end();
+    for (; it != it_end; ++it)
+        updateBackground((*it).first,
+                         (*it).second == m_focused_window ?
+                         m_focused_window_color : m_window_color);
+    clearWindows();
 }
 
 void Workspace::clearWindows() {
-    m_window.clear();
+    if (m_use_buffer) {
+        // the buffer marks all windows dirty when it's done
+        invalidateBuffer();
+        return;
+    }
+
+    FbTk::RedrawScheduler &redraw = *FbTk::RedrawScheduler::instance();
+    redraw.markDirty(m_window);
     WindowList::iterator it = m_windowlist.begin();
     WindowList::iterator it_end = m_windowlist.end();
     for (; it != it_end; ++it) {
         if (m_use_pixmap) {
             updateBackground((*it).first,m_window_color);
         }
-        (*it).second->clear();
+        redraw.markDirty(*(*it).second);
     }
 }
 
 void Workspace::remove(Window win) {
+    if (m_miniwindows.find(win) != m_miniwindows.end()) {
+        if (win == m_grab_client)
+            ungrab();
+        invalidateClient(win);
+        m_index.remove(*this, win);
+        m_miniwindows.erase(win);
+        m_stacking.erase(std::remove(m_stacking.begin(), m_stacking.end(), win),
+                         m_stacking.end());
+        m_iconified.erase(win);
+        return;
+    }
+
     FbTk::FbWindow *fbwin = find(win);
     if (fbwin == 0)
         return;
+    invalidateClient(win);
     FbTk::EventManager::instance()->remove(*fbwin);
     //    FbTk::EventManager::instance()->remove(win);
+    m_index.remove(*this, win);
 
     delete fbwin;
 
@@ -214,6 +514,9 @@ void Workspace::remove(Window win) {
         m_focused_window = 0;
 
     m_windowlist.erase(win);
+    m_stacking.erase(std::remove(m_stacking.begin(), m_stacking.end(), win),
+                     m_stacking.end());
+    m_iconified.erase(win);
 }
 
 
@@ -221,49 +524,168 @@ void Workspace::removeAll() {
     WindowList::iterator it = m_windowlist.begin();
     for (; it != m_windowlist.end(); ++it) {
         FbTk::EventManager::instance()->remove(*(it->second));
+        m_index.remove(*this, it->first);
         delete it->second;
     }
     m_windowlist.clear();
+
+    ungrab();
+    MiniWindowList::iterator mini_it = m_miniwindows.begin();
+    MiniWindowList::iterator mini_it_end = m_miniwindows.end();
+    for (; mini_it != mini_it_end; ++mini_it)
+        m_index.remove(*this, mini_it->first);
+    m_miniwindows.clear();
+    m_stacking.clear();
+
+    m_iconified.clear();
     s_focused_window = 0;
     m_focused_window = 0;
+    m_focused_client = 0;
+    invalidateBuffer();
 }
 
 ClientWindow Workspace::findClient(const FbTk::FbWindow &win) const {
-    WindowList::const_iterator it = m_windowlist.begin();
-    WindowList::const_iterator it_end = m_windowlist.end();
-    for (; it != it_end; ++it) {
-        if (*(*it).second == win)
-            return ClientWindow((*it).first);
-    }
-    return ClientWindow(0);
+    const WindowIndex::Entry *entry = m_index.find(win.window());
+    if (entry == 0 || entry->workspace != this)
+        return ClientWindow(0);
+    return ClientWindow(entry->client);
 }
 
 FbTk::FbWindow *Workspace::find(Window win) {
-    WindowList::iterator it = m_windowlist.begin();
-    WindowList::iterator it_end = m_windowlist.end();
-    for (; it != it_end; ++it) {
-        if ((*it).second->window() == win ||
-            (*it).first == win)
-            return it->second;
-    }
-    return 0;
+    // client window?
+    WindowList::iterator it = m_windowlist.find(win);
+    if (it != m_windowlist.end())
+        return it->second;
+    // mini window?
+    const WindowIndex::Entry *entry = m_index.find(win);
+    if (entry == 0 || entry->workspace != this || entry->client == 0)
+        return 0;
+    return entry->window;
 }
 
 const FbTk::FbWindow *Workspace::find(Window win) const {
-    WindowList::const_iterator it = m_windowlist.begin();
-    WindowList::const_iterator it_end = m_windowlist.end();
-    for (; it != it_end; ++it) {
-        if ((*it).second->window() == win ||
-            (*it).first == win)
-            return it->second;
+    WindowList::const_iterator it = m_windowlist.find(win);
+    if (it != m_windowlist.end())
+        return it->second;
+    const WindowIndex::Entry *entry = m_index.find(win);
+    if (entry == 0 || entry->workspace != this || entry->client == 0)
+        return 0;
+    return entry->window;
+}
+
+bool Workspace::has(Window client) const {
+    return m_windowlist.find(client) != m_windowlist.end() ||
+        m_miniwindows.find(client) != m_miniwindows.end();
+}
+
+Window Workspace::clientAt(int x, int y) const {
+    // sticky clients are drawn on top
+    Window sticky = m_sticky.clientAt(x, y);
+    if (sticky != 0)
+        return sticky;
+
+    const int border = 2*m_window_border_width;
+    // top first
+    for (size_t i = m_stacking.size(); i > 0; --i) {
+        Window client = m_stacking[i - 1];
+        MiniWindowList::const_iterator it = m_miniwindows.find(client);
+        if (it == m_miniwindows.end() ||
+            m_iconified.find(client) != m_iconified.end())
+            continue;
+
+        const MiniWindow &mini = it->second;
+        if (x >= mini.x && x < mini.x + static_cast<int>(mini.width) + border &&
+            y >= mini.y && y < mini.y + static_cast<int>(mini.height) + border)
+            return client;
     }
     return 0;
 }
 
+FbTk::FbWindow *Workspace::grab(Window client) {
+    if (!m_single_window)
+        return find(client);
+
+    ungrab();
+    const MiniWindow *mini_ptr = findMiniWindow(client);
+    if (mini_ptr == 0)
+        return 0;
+
+    const MiniWindow &mini = *mini_ptr;
+    m_grab_window.reset(new FbTk::FbWindow(m_window,
+                                           mini.x, mini.y,
+                                           mini.width, mini.height,
+                                           ExposureMask));
+    m_grab_client = client;
+    FbTk::FbWindow &win = *m_grab_window;
+    win.setBorderWidth(m_window_border_width);
+    win.setBorderColor(m_window_bordercolor);
+
+    // same content as in the back buffer
+    const FbTk::Color &color = client == m_focused_client ?
+        m_focused_window_color : m_window_color;
+    int depth = DefaultDepth(FbTk::App::instance()->display(), m_window.screenNumber());
+    Pixmap icon = m_thumbnails.thumbnail(client, mini.width, mini.height);
+    if (icon == 0 && m_use_pixmap)
+        icon = m_icons.icon(client, mini.width, mini.height, color.pixel(), &depth);
+    if (icon != 0 && depth == m_window.depth())
+        win.setBackgroundPixmap(icon);
+    else
+        win.setBackgroundColor(color);
+
+    FbTk::EventManager::instance()->add(m_eventhandler, win);
+    m_index.add(*this, client, win);
+    win.show();
+    // don't draw it twice
+    invalidateClient(client);
+    return &win;
+}
+
+void Workspace::ungrab() {
+    if (m_grab_window.get() == 0)
+        return;
+
+    FbTk::EventManager::instance()->remove(*m_grab_window);
+    if (findMiniWindow(m_grab_client) != 0)
+        m_index.add(*this, m_grab_client);
+    m_grab_window.reset(0);
+    invalidateClient(m_grab_client);
+    m_grab_client = 0;
+}
+
+const MiniWindow *Workspace::findMiniWindow(Window client) const {
+    MiniWindowList::const_iterator it = m_miniwindows.find(client);
+    if (it != m_miniwindows.end())
+        return &it->second;
+    return m_sticky.find(client);
+}
+
+void Workspace::restack(Window client, bool raise) {
+    std::vector<Window>::iterator it = std::find(m_stacking.begin(),
+                                                 m_stacking.end(), client);
+    if (it == m_stacking.end())
+        return;
+
+    m_stacking.erase(it);
+    if (raise)
+        m_stacking.push_back(client);
+    else
+        m_stacking.insert(m_stacking.begin(), client);
+    invalidateClient(client);
+}
+
 void Workspace::updateFocusedWindow() {
     if (s_focused_window == 0)
         return;
 
+    if (m_single_window) {
+        if (s_focused_window != m_focused_client) {
+            invalidateClient(m_focused_client);
+            invalidateClient(s_focused_window);
+        }
+        m_focused_client = s_focused_window;
+        return;
+    }
+
     FbTk::FbWindow *fbwin = find(s_focused_window);
     if (fbwin == m_focused_window)
         return;
@@ -271,7 +693,7 @@ void Workspace::updateFocusedWindow() {
     if (m_focused_window != 0) {
 
         updateBackground(m_focused_window->window(), m_window_color);
-        m_focused_window->clear();
+        FbTk::RedrawScheduler::instance()->markDirty(*m_focused_window);
     }
 
     if (fbwin == 0) {
@@ -279,46 +701,48 @@ void Workspace::updateFocusedWindow() {
         return;
     }
 
-    WindowList::const_iterator it = m_windowlist.begin();
-    WindowList::const_iterator it_end = m_windowlist.end();
-    for (; it != it_end; ++it) {
-        if ((*it).second == fbwin )
-            break;
-    }
-
-    if (it == it_end)
+    const WindowIndex::Entry *entry = m_index.find(fbwin->window());
+    if (entry == 0)
         return;
 
-    updateBackground((*it).first, m_focused_window_color);
-    fbwin->clear();
+    updateBackground(entry->client, m_focused_window_color);
+    FbTk::RedrawScheduler::instance()->markDirty(*fbwin);
     m_focused_window = fbwin;
 }
 
 void Workspace::updateGeometry(Window win) {
 
     FbTk::FbWindow* fbwin= find(win);
-    if (!fbwin)
-        return;
-
-    int x = 0, y = 0;
-    Window child;
-    ClientWindow client(win);
-    FbRootWindow rootwin(m_window.screenNumber());
-    rootwin.translateCoordinates(client,
-                                 client.x(), client.y(),
-                                 x, y,
-                                 child);
-    x = -x;
-    y = -y;
-    unsigned int w = client.width(), h = client.height();
+    MiniWindowList::iterator mini = m_miniwindows.find(win);
+    if (!fbwin && mini == m_miniwindows.end())
+        return;
+
+    GeometryCache::Geometry geom;
+    if (!m_geometry.geometry(win, geom))
+        return;
+
+    int x = geom.x, y = geom.y;
+    unsigned int w = geom.width, h = geom.height;
+    const FbTk::FbWindow &rootwin = m_geometry.root();
     scaleFromWindowToWindow(rootwin, m_window, x, y);
     scaleFromWindowToWindow(rootwin, m_window, w, h);
-    w -= fbwin->borderWidth();
+    w -= fbwin ? fbwin->borderWidth() : m_window_border_width;
     if (w == 0)
         w = 1;
     if (h == 0)
         h = 1;
 
+    // where it was and where it is now
+    invalidateClient(win);
+    if (mini != m_miniwindows.end()) {
+        mini->second.x = x;
+        mini->second.y = y;
+        mini->second.width = w;
+        mini->second.height = h;
+        invalidateClient(win);
+        return;
+    }
+
     fbwin->moveResize(x, y, w, h);
     updateBackground(win, m_window_color);
 }
@@ -329,23 +753,243 @@ void Workspace::updateBackground(Window win, const FbTk::Color &bg_color) {
     if (!fbwin )
         return;
 
+    if (m_use_buffer || showingSnapshot()) {
+        // color and icon are drawn in the back buffer,
+        // or the snapshot shows the window
+        fbwin->setBackgroundPixmap(ParentRelative);
+        invalidateClient(win);
+        return;
+    }
+
+    Pixmap thumbnail = m_thumbnails.thumbnail(win, fbwin->width(), fbwin->height());
+    if (thumbnail != 0) {
+        fbwin->setBackgroundPixmap(thumbnail);
+        return;
+    }
 
     if (m_use_pixmap) {
-        XWMHints *hints = XGetWMHints(FbTk::App::instance()->display(), win);
-        if (hints && (hints->flags & IconPixmapHint) && hints->icon_pixmap != 0) {
-            FbTk::FbPixmap fbpix;
-            fbpix.copy(hints->icon_pixmap);
-            fbpix.scale(fbwin->width(), fbwin->height());
-            fbwin->setBackgroundPixmap(fbpix.drawable());
-        }
+        Pixmap icon = m_icons.icon(win, fbwin->width(), fbwin->height(),
+                                   bg_color.pixel());
+        if (icon != 0)
+            fbwin->setBackgroundPixmap(icon);
         else
             fbwin->setBackgroundColor(bg_color);
-
-        XFree(hints);
     }
     else
         fbwin->setBackgroundColor(bg_color);
 }
 
+void Workspace::updateThumbnail(Window client) {
+    if (findMiniWindow(client) != 0) {
+        invalidateClient(client);
+        return;
+    }
+
+    FbTk::FbWindow *fbwin = find(client);
+    if (fbwin == 0)
+        return;
+
+    if (m_use_buffer) {
+        invalidateClient(client);
+        return;
+    }
+
+    updateBackground(client, fbwin == m_focused_window ?
+                     m_focused_window_color : m_window_color);
+    FbTk::RedrawScheduler::instance()->markDirty(*fbwin);
+}
+
+void Workspace::invalidateBuffer() {
+    invalidateBuffer(rectangle(0, 0, m_window.width(), m_window.height()));
+}
+
+void Workspace::invalidateBuffer(const XRectangle &area) {
+    if (!m_use_buffer)
+        return;
+
+    // only inside of the workspace
+    const int x1 = std::max(static_cast<int>(area.x), 0);
+    const int y1 = std::max(static_cast<int>(area.y), 0);
+    const int x2 = std::min(area.x + static_cast<int>(area.width),
+                            static_cast<int>(m_window.width()));
+    const int y2 = std::min(area.y + static_cast<int>(area.height),
+                            static_cast<int>(m_window.height()));
+    if (x2 <= x1 || y2 <= y1)
+        return;
+
+    // a long clip list costs more than drawing the bounding box
+    if (m_dirty.size() >= 16) {
+        XRectangle bounds = boundingBox(m_dirty);
+        m_dirty.assign(1, bounds);
+    }
+    m_dirty.push_back(rectangle(x1, y1, x2 - x1, y2 - y1));
+
+    if (!m_render_timer.isTiming())
+        m_render_timer.start();
+}
+
+void Workspace::invalidateClient(Window client) {
+    const MiniWindow *mini = findMiniWindow(client);
+    if (mini != 0) {
+        invalidateBuffer(rectangle(mini->x, mini->y,
+                                   mini->width + 2*m_window_border_width,
+                                   mini->height + 2*m_window_border_width));
+        return;
+    }
+
+    const FbTk::FbWindow *fbwin = find(client);
+    if (fbwin != 0)
+        invalidateBuffer(rectangle(fbwin->x(), fbwin->y(),
+                                   fbwin->width() + 2*fbwin->borderWidth(),
+                                   fbwin->height() + 2*fbwin->borderWidth()));
+}
+
+void Workspace::renderBuffer() {
+    if (!m_use_buffer || m_window.width() == 0 || m_window.height() == 0)
+        return;
+
+    // create the new buffer before the old is freed so the
+    // transparency target always gets a new pixmap id
+    if (m_buffer.width() != m_window.width() ||
+        m_buffer.height() != m_window.height()) {
+        FbTk::FbPixmap buffer(m_window, m_window.width(), m_window.height(),
+                              m_window.depth());
+        m_window.setBufferPixmap(buffer.drawable());
+        m_buffer = buffer.release();
+        m_dirty.assign(1, rectangle(0, 0, m_buffer.width(), m_buffer.height()));
+    }
+    if (m_buffer.drawable() == 0 || m_dirty.empty())
+        return;
+
+    Display *disp = FbTk::App::instance()->display();
+    FbTk::GContext gc(m_buffer);
+    gc.setGraphicsExposure(false);
+    // the buffer persists, only the dirty areas are drawn again
+    const XRectangle bounds = boundingBox(m_dirty);
+    gc.setClipRectangles(&m_dirty[0], m_dirty.size());
+
+    // the snapshot already shows the windows
+    size_t num_windows = 0;
+    if (showingSnapshot()) {
+        m_buffer.copyArea(m_snapshot.drawable(), gc.gc(),
+                          bounds.x, bounds.y, bounds.x, bounds.y,
+                          bounds.width, bounds.height);
+    } else {
+        gc.setForeground(m_background_color);
+        m_buffer.fillRectangle(gc.gc(), bounds.x, bounds.y,
+                               bounds.width, bounds.height);
+
+        // draw mini windows in stacking order, bottom first
+        if (m_single_window)
+            drawMiniWindows(gc, bounds);
+        else
+            num_windows = m_stacking.size();
+    }
+
+    for (size_t i = 0; i < num_windows; ++i) {
+        WindowList::const_iterator win_it = m_windowlist.find(m_stacking[i]);
+        // a window dragged to another workspace isn't ours to draw
+        if (win_it == m_windowlist.end() ||
+            win_it->second->parent() != &m_window ||
+            m_iconified.find(win_it->first) != m_iconified.end())
+            continue;
+
+        const FbTk::FbWindow &fbwin = *win_it->second;
+        // inside of the border
+        int x = fbwin.x() + fbwin.borderWidth();
+        int y = fbwin.y() + fbwin.borderWidth();
+        if (!intersects(bounds, rectangle(x, y, fbwin.width(), fbwin.height())))
+            continue;
+
+        const FbTk::Color &color = win_it->second == m_focused_window ?
+            m_focused_window_color : m_window_color;
+        int depth = DefaultDepth(disp, m_window.screenNumber());
+        Pixmap icon = m_thumbnails.thumbnail(win_it->first,
+                                             fbwin.width(), fbwin.height());
+        if (icon == 0 && m_use_pixmap)
+            icon = m_icons.icon(win_it->first, fbwin.width(), fbwin.height(),
+                                color.pixel(), &depth);
+        if (icon != 0 && depth == m_buffer.depth()) {
+            m_buffer.copyArea(icon, gc.gc(), 0, 0, x, y,
+                              fbwin.width(), fbwin.height());
+        } else {
+            gc.setForeground(color);
+            m_buffer.fillRectangle(gc.gc(), x, y, fbwin.width(), fbwin.height());
+        }
+    }
+
+    // one composite for the dirty areas
+    m_window.updateTransparent(&m_dirty[0], m_dirty.size());
+
+    // the background is still needed for expose and the mini windows,
+    // but the window itself is updated with one copy of the dirty areas
+    m_window.setBackgroundPixmap(m_buffer.drawable());
+    XCopyArea(disp, m_buffer.drawable(), m_window.window(), gc.gc(),
+              bounds.x, bounds.y, bounds.width, bounds.height,
+              bounds.x, bounds.y);
+    m_dirty.clear();
+
+    FbTk::RedrawScheduler &redraw = *FbTk::RedrawScheduler::instance();
+    WindowList::iterator it = m_windowlist.begin();
+    WindowList::iterator it_end = m_windowlist.end();
+    for (; it != it_end; ++it) {
+        FbTk::FbWindow &fbwin = *(*it).second;
+        if (intersects(bounds, rectangle(fbwin.x(), fbwin.y(),
+                                         fbwin.width() + 2*fbwin.borderWidth(),
+                                         fbwin.height() + 2*fbwin.borderWidth())))
+            redraw.markDirty(fbwin);
+    }
+}
+
+void Workspace::drawMiniWindows(FbTk::GContext &gc, const XRectangle &bounds) {
+    const unsigned int border = m_window_border_width;
+    const int default_depth = DefaultDepth(FbTk::App::instance()->display(),
+                                           m_window.screenNumber());
+    // sticky clients on top
+    std::vector<Window> stacking(m_stacking);
+    stacking.insert(stacking.end(),
+                    m_sticky.stacking().begin(), m_sticky.stacking().end());
+
+    MiniWindowBatch batch;
+    for (size_t i = 0; i < stacking.size(); ++i) {
+        Window client = stacking[i];
+        const MiniWindow *mini_ptr = findMiniWindow(client);
+        if (mini_ptr == 0 || client == m_grab_client ||
+            m_iconified.find(client) != m_iconified.end() ||
+            m_sticky.iconic(client))
+            continue;
+
+        const MiniWindow &mini = *mini_ptr;
+        XRectangle area = rectangle(mini.x, mini.y,
+                                    mini.width + 2*border, mini.height + 2*border);
+        if (!intersects(bounds, area))
+            continue;
+        // windows below have to be drawn first
+        if (batch.overlaps(area))
+            batch.draw(m_buffer.drawable(), gc.gc(), m_window_bordercolor,
+                       m_window_color, m_focused_window_color);
+
+        batch.area.push_back(area);
+        batch.addBorder(area, border);
+
+        const bool focused = client == m_focused_client;
+        const FbTk::Color &color = focused ? m_focused_window_color : m_window_color;
+        int depth = default_depth;
+        Pixmap icon = m_thumbnails.thumbnail(client, mini.width, mini.height);
+        if (icon == 0 && m_use_pixmap)
+            icon = m_icons.icon(client, mini.width, mini.height, color.pixel(), &depth);
+        // nothing in this batch overlaps it, so it can be copied right away
+        if (icon != 0 && depth == m_buffer.depth())
+            m_buffer.copyArea(icon, gc.gc(), 0, 0, mini.x + border, mini.y + border,
+                              mini.width, mini.height);
+        else
+            batch.fills[focused].push_back(rectangle(mini.x + border, mini.y + border,
+                                                     mini.width, mini.height));
+    }
+
+    batch.draw(m_buffer.drawable(), gc.gc(), m_window_bordercolor,
+               m_window_color, m_focused_window_color);
+}
+
 }; // end namespace FbPager
 
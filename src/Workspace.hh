@@ -29,15 +29,29 @@
 #include "FbTk/NotCopyable.hh"
 #include "FbTk/EventHandler.hh"
 #include "FbTk/Color.hh"
+#include "FbTk/Timer.hh"
+#include "FbTk/SimpleCommand.hh"
 
 #include "ClientWindow.hh"
+#include "StickyLayer.hh"
 
 #include <string>
 #include <map>
+#include <set>
+#include <vector>
 #include <memory>
 
+namespace FbTk {
+class GContext;
+}
+
 namespace FbPager {
 
+class WindowIndex;
+class GeometryCache;
+class IconCache;
+class Thumbnails;
+
 /**
    Workspace window for fbpager
 */
@@ -46,6 +60,10 @@ public:
 
     /// create a workspace with specified name, size, parent and eventhandler
     Workspace(FbTk::EventHandler &evh,
+              WindowIndex &index, GeometryCache &geometry,
+              IconCache &icons, Thumbnails &thumbnails,
+              StickyLayer &sticky,
+              unsigned int number,
               FbTk::FbWindow &parent, unsigned int width, unsigned int height,
               const FbTk::Color &focused_win_color,
               const FbTk::Color &wincolor,
@@ -77,7 +95,33 @@ public:
                         const std::string &unfocused,
                         const std::string &bordercolor_str);
     void setAlpha(unsigned char alpha);
+    void setBackgroundColor(const FbTk::Color &color);
+    /**
+       Composite the wallpaper once into a back buffer of the workspace
+       instead of once per mini window. Mini windows then show the
+       buffer through a ParentRelative background.
+    */
+    void setUseBuffer(bool use_buffer);
+    /**
+       Draw the mini windows into the back buffer instead of creating
+       a window for each of them. Needs the back buffer. Windows are
+       added again, so shade and iconic state must be set again.
+    */
+    void setSingleWindow(bool single);
+    bool singleWindow() const { return m_single_window; }
     void clearWindows();
+    /// redraw area of the back buffer before the next frame
+    void invalidateBuffer(const XRectangle &area);
+    /// content of client's window changed, shows the new thumbnail
+    void updateThumbnail(Window client);
+    /**
+       Keeps a copy of what root shows, scaled down to the size of the
+       workspace right away. It's shown by showSnapshot.
+    */
+    void takeSnapshot(const FbTk::FbWindow &root);
+    /// show the snapshot as background, while the workspace isn't visible
+    void showSnapshot(bool show);
+    void dropSnapshot();
 
     ClientWindow findClient(const FbTk::FbWindow &win) const;
 
@@ -88,8 +132,26 @@ public:
     FbTk::FbWindow *find(Window win);
     /// find associated FbWindow to win
     const FbTk::FbWindow *find(Window win) const;
+    /// @return true if client is shown on this workspace
+    bool has(Window client) const;
+    /**
+       @brief Find the client drawn at x, y in single window mode,
+       sticky clients included
+       @return 0 on failure
+    */
+    Window clientAt(int x, int y) const;
+    /**
+       Get a mini window for client that can be dragged. In single
+       window mode it's created and lives until ungrab.
+       @return 0 on failure
+    */
+    FbTk::FbWindow *grab(Window client);
+    /// destroy the mini window created by grab
+    void ungrab();
     /// @return workspace name
     const std::string &name() const { return m_name; }
+    /// @return workspace number
+    unsigned int number() const { return m_number; }
     /// @return the workspace's FbWindow
     const FbTk::FbWindow &window() const { return m_window; }
     /// @return the workspace's FbWindow
@@ -100,14 +162,45 @@ public:
 private:
 
     void updateBackground(Window win, const FbTk::Color& bg_color);
+    /// redraw the back buffer before the next frame
+    void invalidateBuffer();
+    /// redraw the back buffer where the mini window of client is
+    void invalidateClient(Window client);
+    /// draws background, mini windows and wallpaper into the back buffer
+    void renderBuffer();
+    /// sets the background of the workspace window and all mini windows
+    void updateBackgrounds();
+    /// draws the mini windows of single window mode within bounds into the back buffer
+    void drawMiniWindows(FbTk::GContext &gc, const XRectangle &bounds);
+    /// @return mini window of client in single window mode, own or sticky
+    const MiniWindow *findMiniWindow(Window client) const;
+    /// moves client to the top or bottom in single window mode
+    void restack(Window client, bool raise);
+    bool showingSnapshot() const {
+        return m_show_snapshot && m_snapshot.drawable() != 0;
+    }
 
     std::string m_name; ///< name of this workspace
     FbTk::FbWindow m_window; ///< FbWindow of this workspace
     FbTk::EventHandler &m_eventhandler;
+    WindowIndex &m_index; ///< shared by all workspaces
+    GeometryCache &m_geometry; ///< shared by all workspaces
+    IconCache &m_icons; ///< shared by all workspaces
+    Thumbnails &m_thumbnails; ///< shared by all workspaces
+    StickyLayer &m_sticky; ///< shared by all workspaces
+    unsigned int m_number;
 
     typedef std::map<Window, FbTk::FbWindow*> WindowList;
     WindowList m_windowlist; ///< holds a set of Window to FbWindow association
 
+    typedef std::map<Window, MiniWindow> MiniWindowList;
+    MiniWindowList m_miniwindows; ///< clients drawn in single window mode
+    std::vector<Window> m_stacking; ///< clients in both modes, bottom first
+    bool m_single_window;
+    Window m_focused_client; ///< focused client, as drawn in single window mode
+    Window m_grab_client;
+    std::auto_ptr<FbTk::FbWindow> m_grab_window; ///< dragged mini window in single window mode
+
     FbTk::Color m_window_color, m_focused_window_color, m_window_bordercolor;
     FbTk::FbWindow *m_focused_window;
 
@@ -116,6 +209,17 @@ private:
     bool m_use_pixmap;
     int  m_window_border_width;
 
+    FbTk::Color m_background_color;
+    unsigned char m_alpha;
+    bool m_use_buffer;
+    FbTk::FbPixmap m_buffer; ///< workspace background with mini windows and wallpaper
+    std::vector<XRectangle> m_dirty; ///< areas of m_buffer to draw again
+    std::set<Window> m_iconified; ///< clients with hidden mini windows
+    FbTk::FbPixmap m_snapshot; ///< scaled screen content from the last visit
+    bool m_show_snapshot;
+    FbTk::SimpleCommand<Workspace> m_render_cmd;
+    FbTk::Timer m_render_timer;
+
 };
 
 }; // end namespace FbPager